@@ -16,6 +16,9 @@
 AnalysisGraphContent::AnalysisGraphContent(std::shared_ptr<DataManager> d) : timer([this] () {timerCallback();}) , textTimer([this] () {textTimerCallback();})
 {
     dataManager = d;
+    
+    setOpaque(true); // so a metering repaint stops here rather than repainting the canvas behind it
+    
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
     
@@ -36,56 +39,47 @@ void AnalysisGraphContent::paint (juce::Graphics& g)
     {
         g.setColour(juce::Colour(0xffEADEED));
         
-        if (selectedId != -1 && !isnan(dataManager->activeInstance->valueStreams[selectedId].value))
+        const int numFilled = history.getColumns(plotValues, numColumns, columns.get());
+        
+        if (numFilled > 0)
         {
-            float x2 = xVal + 1;
-            float y2 = -dataManager->activeInstance->valueStreams[selectedId].value;
-            
-            if (xVal == 0) {
-                graphPath.addEllipse(xVal, isnan(prevVal) ? -dataManager->activeInstance->valueStreams[selectedId].value : prevVal, 1e-5, 1e-5);
-            }
+            auto range = columns[0];
             
-            graphPath.lineTo({x2, y2});
+            for (int column = 1; column < numFilled; column++)
+                range = range.getUnionWith(columns[column]);
             
-            prevVal = -dataManager->activeInstance->valueStreams[selectedId].value;
+            // a flat line sits in the middle rather than dividing by zero
+            auto shownRange = range.getLength() > 1e-6f ? range : range.expanded(0.5f);
             
-            xVal++;
+            const float height = (float) getHeight();
             
-            juce::AffineTransform pathTransform = graphPath.getTransformToScaleToFit(getLocalBounds().toFloat(), false);
+            auto getY = [&] (float value) {
+                return height - 1.0f - (value - shownRange.getStart()) / shownRange.getLength() * (height - 2.0f);
+            };
             
-            pathTransform.mat00 = 1;
-            
-            if (xVal >= getWidth())
-                pathTransform.mat02 = getWidth() - xVal;
-            else
-                pathTransform.mat02 = 0;
-            
-            if (xVal >= getWidth() * 2)
-            {
-                // TODO: periodically clear path
-            }
+            // down and up through each column's range, which joins neighbouring columns and keeps any peaks within them
+            graphPath.clear();
+            graphPath.preallocateSpace(numFilled * 6 + 3);
             
-            auto p = juce::Path(graphPath);
+            graphPath.startNewSubPath(0.0f, getY(columns[0].getEnd()));
             
-            for (auto i : {pathTransform.mat00, pathTransform.mat01, pathTransform.mat02, pathTransform.mat10, pathTransform.mat11, pathTransform.mat12})
+            for (int column = 0; column < numFilled; column++)
             {
-                if (isnan(i) || isinf(i)) goto dontApplyTransform;
+                graphPath.lineTo((float) column, getY(columns[column].getEnd()));
+                graphPath.lineTo((float) column, getY(columns[column].getStart()));
             }
             
-            p.applyTransform(pathTransform);
-            
-            dontApplyTransform:
-            g.strokePath(p, juce::PathStrokeType(1.0f));
+            g.strokePath(graphPath, juce::PathStrokeType(1.0f));
             
             // TODO: add + sign for positive values
-            auto topText = juce::String::toDecimalStringWithSignificantFigures(std::round(-graphPath.getBounds().getY() * 1e3) / 1e3, 3);
-            auto bottomText = juce::String::toDecimalStringWithSignificantFigures(std::round(-graphPath.getBounds().getBottom() * 1e3) / 1e3, 3);
+            auto topText = juce::String::toDecimalStringWithSignificantFigures(std::round(range.getEnd() * 1e3) / 1e3, 3);
+            auto bottomText = juce::String::toDecimalStringWithSignificantFigures(std::round(range.getStart() * 1e3) / 1e3, 3);
             
             g.setFont(juce::FontOptions(14.0f));
             
             g.setColour(juce::Colour(0xa0000000));
             g.fillRect(2, 2, g.getCurrentFont().getStringWidth(topText) + 4, 16);
-            g.fillRect(2, 100 - 16 - 2, g.getCurrentFont().getStringWidth(bottomText) + 4, 16);
+            g.fillRect(2, getHeight() - 16 - 2, g.getCurrentFont().getStringWidth(bottomText) + 4, 16);
             g.fillRect(getWidth() - g.getCurrentFont().getStringWidth(currText) - 4 - 2, 2, g.getCurrentFont().getStringWidth(currText) + 4, 16);
             
             g.setColour(juce::Colour(0xffFA1012));
@@ -110,7 +104,11 @@ void AnalysisGraphContent::paint (juce::Graphics& g)
 //                juce::Justification::centred, true);   // draw some placeholder text
 }
 
-void AnalysisGraphContent::resized() { }
+void AnalysisGraphContent::resized()
+{
+    numColumns = juce::jmax(1, getWidth());
+    columns.allocate((size_t) numColumns, false);
+}
 
 void AnalysisGraphContent::mouseDown(const juce::MouseEvent &)
 {
@@ -126,8 +124,7 @@ void AnalysisGraphContent::updateMetering()
         textTimer.startTimer(textTimerInterval);
         textTimerCallback();
         
-        graphPath.clear();
-        xVal = 0;
+        history.clear();
     } else {
         timer.stopTimer();
         textTimer.stopTimer();
@@ -136,6 +133,14 @@ void AnalysisGraphContent::updateMetering()
 
 void AnalysisGraphContent::timerCallback()
 {
+    // sampled here rather than in paint(), which can run at any rate
+    if (selectedId != -1 && selectedType == ParameterType::Value)
+    {
+        const float value = dataManager->getDisplayValue(selectedId);
+        
+        if (!std::isnan(value)) history.push(value);
+    }
+    
     repaint();
 }
 
@@ -143,16 +148,20 @@ void AnalysisGraphContent::textTimerCallback()
 {
     // update the current text if analysing
     if (!analysingRn) return;
-    currText = juce::String::toDecimalStringWithSignificantFigures(std::round(-prevVal * 1e3) / 1e3, 3);
+    currText = juce::String::toDecimalStringWithSignificantFigures(std::round(history.getLatest() * 1e3) / 1e3, 3);
 }
 
 void AnalysisGraphContent::setSelection()
 {
     selectedId = -1;
+    history.clear();
 }
 
 void AnalysisGraphContent::setSelection(ParameterType type, int streamId)
 {
+    if (streamId == selectedId && type == selectedType) return; // e.g. the inspector being laid out again
+    
     selectedId = streamId;
     selectedType = type;
+    history.clear();
 }
@@ -12,6 +12,7 @@
 
 #include <JuceHeader.h>
 #include "DataManager.h"
+#include "PlotHistory.h"
 
 //==============================================================================
 /*
@@ -30,7 +31,7 @@ public:
     void setSelection(ParameterType type, int streamId);
 
 private:
-    bool analysingRn;
+    bool analysingRn = false;
     void updateMetering();
     void timerCallback();
     void textTimerCallback();
@@ -40,16 +41,20 @@ private:
     juce::String currText;
     
     ParameterType selectedType;
-    int selectedId;
-    
-    juce::Path graphPath;
-    float xVal = 0;
-    
-    float prevVal = NAN;
+    int selectedId = -1;
     
     const int timerInterval = 10;
     const int textTimerInterval = 100;
     
+    // the value is sampled every timerInterval, and the plot spans the last plotValues of them
+    static constexpr int plotValues = 1000;
+    
+    PlotHistory history {plotValues};
+    juce::HeapBlock<juce::Range<float>> columns; // one per pixel column, so painting never allocates
+    int numColumns = 0;
+    
+    juce::Path graphPath; // cleared rather than made for each paint, so it keeps its storage
+    
     std::shared_ptr<DataManager> dataManager;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalysisGraphContent)
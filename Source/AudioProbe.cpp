@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+  
+    AudioProbe.cpp
+    Created: 19 Oct 2026 11:02:17pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include "AudioProbe.h"
+
+void AudioProbe::start(int audioStreamId)
+{
+    if (ring == nullptr)
+        ring.allocate((size_t) capacity, true);
+    
+    // reading everything that's ready is the reader's side of the fifo, so this is safe while the audio thread writes
+    fifo.finishedRead(fifo.getNumReady());
+    
+    streamId = audioStreamId; // published after the ring exists, so the audio thread never writes into nothing
+}
+
+void AudioProbe::stop()
+{
+    streamId = -1;
+}
+
+template <typename SampleType>
+void AudioProbe::write(const juce::AudioBuffer<SampleType>& buffer, int numSamples, bool isSilent)
+{
+    const auto scope = fifo.write(numSamples);
+    
+    if (isSilent)
+    {
+        juce::FloatVectorOperations::clear(ring + scope.startIndex1, scope.blockSize1);
+        juce::FloatVectorOperations::clear(ring + scope.startIndex2, scope.blockSize2);
+        return;
+    }
+    
+    mixToMono(ring + scope.startIndex1, buffer, 0, scope.blockSize1);
+    mixToMono(ring + scope.startIndex2, buffer, scope.blockSize1, scope.blockSize2);
+}
+
+template <typename SampleType>
+void AudioProbe::mixToMono(float* dest, const juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples)
+{
+    const int numChannels = buffer.getNumChannels();
+    
+    if (numSamples == 0) return;
+    
+    if (numChannels == 0)
+    {
+        juce::FloatVectorOperations::clear(dest, numSamples);
+        return;
+    }
+    
+    const float channelGain = 1.0f / (float) numChannels;
+    
+    if constexpr (std::is_same<SampleType, float>::value)
+    {
+        juce::FloatVectorOperations::copyWithMultiply(dest, buffer.getReadPointer(0, startSample), channelGain, numSamples);
+        
+        for (int channel = 1; channel < numChannels; channel++)
+            juce::FloatVectorOperations::addWithMultiply(dest, buffer.getReadPointer(channel, startSample), channelGain, numSamples);
+    }
+    else
+    {
+        juce::FloatVectorOperations::clear(dest, numSamples);
+        
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            auto src = buffer.getReadPointer(channel, startSample);
+            
+            for (int sample = 0; sample < numSamples; sample++)
+                dest[sample] += (float) src[sample] * channelGain;
+        }
+    }
+}
+
+int AudioProbe::read(float* dest, int maxSamples)
+{
+    const auto scope = fifo.read(juce::jmin(maxSamples, fifo.getNumReady()));
+    
+    juce::FloatVectorOperations::copy(dest, ring + scope.startIndex1, scope.blockSize1);
+    juce::FloatVectorOperations::copy(dest + scope.blockSize1, ring + scope.startIndex2, scope.blockSize2);
+    
+    return scope.blockSize1 + scope.blockSize2;
+}
+
+template void AudioProbe::write<float>(const juce::AudioBuffer<float>&, int, bool);
+template void AudioProbe::write<double>(const juce::AudioBuffer<double>&, int, bool);
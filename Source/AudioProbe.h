@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+  
+    AudioProbe.h
+    Created: 19 Oct 2026 11:02:17pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ Taps one audio stream for the inspector, so it can be looked at without a meter node in the graph.
+ While started, the audio thread sums the stream to mono into a fixed ring through an AbstractFifo, and the message thread reads it back out; if the reader falls behind for long enough to fill the ring, the newest samples are dropped rather than blocking.
+ Stopped, it costs the audio thread one atomic load per block, and the ring isn't allocated until the first probe is started.
+ */
+class AudioProbe
+{
+public:
+    static constexpr int capacity = 1 << 16; // over a second at 48kHz, and the reader drains it far more often than that
+    
+    void start(int audioStreamId); // message thread; skips anything left from a previous probe
+    void stop();
+    
+    int getStreamId() {return streamId.load();} // -1 while stopped
+    
+    template <typename SampleType>
+    void write(const juce::AudioBuffer<SampleType>& buffer, int numSamples, bool isSilent); // audio thread
+    
+    int read(float* dest, int maxSamples); // message thread; returns how many were read
+    
+private:
+    template <typename SampleType>
+    void mixToMono(float* dest, const juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples);
+    
+    std::atomic<int> streamId {-1};
+    
+    juce::AbstractFifo fifo {capacity};
+    juce::HeapBlock<float> ring;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioProbe)
+};
@@ -0,0 +1,226 @@
+/*
+  ==============================================================================
+  
+    AudioProbeContent.cpp
+    Created: 19 Oct 2026 11:02:17pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "AudioProbeContent.h"
+
+//==============================================================================
+AudioProbeContent::AudioProbeContent(std::shared_ptr<DataManager> d) : timer([this] () {timerCallback();})
+{
+    dataManager = d;
+    
+    setOpaque(true); // like the value plot, so a repaint stops here
+    
+    juce::FloatVectorOperations::clear(fftFifo, fftSize);
+    juce::FloatVectorOperations::fill(spectrumDb, minDb, numBins);
+}
+
+AudioProbeContent::~AudioProbeContent()
+{
+    if (probing) dataManager->probe.stop();
+}
+
+void AudioProbeContent::paint (juce::Graphics& g)
+{
+    g.fillAll (juce::Colour(0xff222222));   // clear the background
+    
+    auto waveformArea = getLocalBounds();
+    auto spectrumArea = waveformArea.removeFromBottom(getHeight() / 2);
+    
+    g.setColour(juce::Colour(0xff444444));
+    g.drawHorizontalLine(waveformArea.getCentreY(), 0.0f, (float) getWidth());
+    
+    paintWaveform(g, waveformArea);
+    paintSpectrum(g, spectrumArea);
+    
+    g.setColour (juce::Colour(0xffAAAAAA));
+    g.drawRect (getLocalBounds(), 1);   // draw an outline around the component
+    g.drawHorizontalLine(spectrumArea.getY(), 0.0f, (float) getWidth());
+}
+
+void AudioProbeContent::paintWaveform(juce::Graphics& g, juce::Rectangle<int> area)
+{
+    const int numFilled = history.getColumns(waveformSamples, numColumns, columns.get());
+    
+    if (numFilled == 0) return;
+    
+    const float halfHeight = area.getHeight() * 0.5f - 1.0f;
+    const float centre = (float) area.getCentreY();
+    
+    auto getY = [&] (float value) {
+        return centre - juce::jlimit(-1.0f, 1.0f, value) * halfHeight;
+    };
+    
+    // down and up through each column's range, as the value plot does
+    graphPath.clear();
+    graphPath.preallocateSpace(numFilled * 6 + 3);
+    
+    graphPath.startNewSubPath(0.0f, getY(columns[0].getEnd()));
+    
+    for (int column = 0; column < numFilled; column++)
+    {
+        graphPath.lineTo((float) column, getY(columns[column].getEnd()));
+        graphPath.lineTo((float) column, getY(columns[column].getStart()));
+    }
+    
+    g.setColour(juce::Colour(0xffEADEED));
+    g.strokePath(graphPath, juce::PathStrokeType(1.0f));
+}
+
+void AudioProbeContent::paintSpectrum(juce::Graphics& g, juce::Rectangle<int> area)
+{
+    const float nyquist = (float) dataManager->getActiveInstance()->sampleRate * 0.5f;
+    
+    if (nyquist <= minFrequency || area.getWidth() <= 0) return;
+    
+    const float binWidth = nyquist / (float) (numBins - 1);
+    const float width = (float) area.getWidth();
+    
+    // frequency is logarithmic across the width, and each column shows the loudest bin it covers
+    auto getBin = [&] (int x) {
+        return minFrequency * std::pow(nyquist / minFrequency, (float) x / width) / binWidth;
+    };
+    
+    auto getY = [&] (float db) {
+        return (float) area.getY() + 1.0f + (db / minDb) * (area.getHeight() - 2.0f);
+    };
+    
+    graphPath.clear();
+    graphPath.preallocateSpace(area.getWidth() * 3 + 3);
+    
+    for (int x = 0; x < area.getWidth(); x++)
+    {
+        const int firstBin = juce::jlimit(0, numBins - 1, (int) getBin(x));
+        const int lastBin = juce::jlimit(firstBin, numBins - 1, (int) getBin(x + 1));
+        
+        float db = spectrumDb[firstBin];
+        
+        for (int bin = firstBin + 1; bin <= lastBin; bin++)
+            db = juce::jmax(db, spectrumDb[bin]);
+        
+        if (x == 0) graphPath.startNewSubPath((float) x, getY(db));
+        else graphPath.lineTo((float) x, getY(db));
+    }
+    
+    g.setColour(juce::Colour(0xffEADEED));
+    g.strokePath(graphPath, juce::PathStrokeType(1.0f));
+    
+    g.setFont(juce::FontOptions(14.0f));
+    g.setColour(juce::Colour(0xffFA1012));
+    g.drawText(juce::String((int) minDb) + "dB", area.reduced(5), juce::Justification::bottomLeft, true);
+    g.drawText("0dB", area.reduced(5), juce::Justification::topLeft, true);
+}
+
+void AudioProbeContent::resized()
+{
+    numColumns = juce::jmax(1, getWidth());
+    columns.allocate((size_t) numColumns, false);
+}
+
+void AudioProbeContent::visibilityChanged()
+{
+    updateProbe();
+}
+
+void AudioProbeContent::setSelection()
+{
+    selectedId = -1;
+    updateProbe();
+}
+
+void AudioProbeContent::setSelection(int audioStreamId)
+{
+    if (audioStreamId == selectedId) return; // e.g. the inspector being laid out again
+    
+    selectedId = audioStreamId;
+    
+    history.clear();
+    juce::FloatVectorOperations::clear(fftFifo, fftSize);
+    juce::FloatVectorOperations::fill(spectrumDb, minDb, numBins);
+    fftFifoIndex = 0;
+    
+    if (probing && selectedId != -1)
+        dataManager->probe.start(selectedId); // moves straight over to the new stream
+    
+    updateProbe();
+    repaint();
+}
+
+void AudioProbeContent::updateProbe()
+{
+    const bool shouldProbe = selectedId != -1 && isVisible();
+    
+    if (shouldProbe == probing) return;
+    
+    probing = shouldProbe;
+    
+    if (probing)
+    {
+        dataManager->probe.start(selectedId);
+        timer.startTimer(timerInterval);
+    }
+    else
+    {
+        dataManager->probe.stop();
+        timer.stopTimer();
+    }
+}
+
+void AudioProbeContent::timerCallback()
+{
+    bool anyRead = false;
+    
+    for (int numRead; (numRead = dataManager->probe.read(readBlock, readBlockSize)) > 0;)
+    {
+        history.push(readBlock, numRead);
+        pushSpectrum(readBlock, numRead);
+        anyRead = true;
+    }
+    
+    if (!anyRead) return; // nothing is being processed, so the last picture still stands
+    
+    computeSpectrum();
+    repaint();
+}
+
+void AudioProbeContent::pushSpectrum(const float* samples, int numSamples)
+{
+    while (numSamples > 0)
+    {
+        const int numToWrite = juce::jmin(numSamples, fftSize - fftFifoIndex);
+        
+        juce::FloatVectorOperations::copy(fftFifo + fftFifoIndex, samples, numToWrite);
+        
+        fftFifoIndex = (fftFifoIndex + numToWrite) % fftSize;
+        samples += numToWrite;
+        numSamples -= numToWrite;
+    }
+}
+
+void AudioProbeContent::computeSpectrum()
+{
+    // once per tick, of the latest fftSize samples; the spectral nodes hop far more often, but nobody can watch that fast
+    const int numOldest = fftSize - fftFifoIndex;
+    
+    juce::FloatVectorOperations::copy(fftData, fftFifo + fftFifoIndex, numOldest);
+    juce::FloatVectorOperations::copy(fftData + numOldest, fftFifo, fftFifoIndex);
+    juce::FloatVectorOperations::clear(fftData + fftSize, fftSize);
+    
+    shared->getSpectrumWindow().multiplyWithWindowingTable(fftData, (size_t) fftSize);
+    shared->getSpectrumFFT().performFrequencyOnlyForwardTransform(fftData, true);
+    
+    for (int bin = 0; bin < numBins; bin++)
+    {
+        // scaled as SpectrumCache does, so a full scale sine peaks at 0dB
+        const float db = juce::Decibels::gainToDecibels(fftData[bin] * 4.0f / (float) fftSize, minDb);
+        
+        spectrumDb[bin] = juce::jmax(db, spectrumDb[bin] - dbFallPerTick);
+    }
+}
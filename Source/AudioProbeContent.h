@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+  
+    AudioProbeContent.h
+    Created: 19 Oct 2026 11:02:17pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DataManager.h"
+#include "PlotHistory.h"
+#include "SpectrumCache.h"
+
+//==============================================================================
+/*
+ The inspector's view of an audio stream: the waveform above, and its spectrum below.
+ The DataManager's probe only runs while this is visible with a stream selected, so looking at nothing costs the audio thread nothing.
+*/
+class AudioProbeContent  : public juce::Component
+{
+public:
+    AudioProbeContent(std::shared_ptr<DataManager>);
+    ~AudioProbeContent() override;
+    
+    void paint (juce::Graphics&) override;
+    void resized() override;
+    void visibilityChanged() override;
+    
+    void setSelection();
+    void setSelection(int audioStreamId);
+
+private:
+    void updateProbe(); // starts or stops the probe and the timer to match the selection and visibility
+    void timerCallback();
+    juce::TimedCallback timer;
+    
+    void pushSpectrum(const float* samples, int numSamples);
+    void computeSpectrum();
+    
+    void paintWaveform(juce::Graphics& g, juce::Rectangle<int> area);
+    void paintSpectrum(juce::Graphics& g, juce::Rectangle<int> area);
+    
+    int selectedId = -1;
+    bool probing = false;
+    
+    const int timerInterval = 30;
+    
+    static constexpr int waveformSamples = 4096; // about 90ms at 48kHz
+    static constexpr int readBlockSize = 1024;
+    
+    PlotHistory history {waveformSamples};
+    juce::HeapBlock<juce::Range<float>> columns; // one per pixel column, so painting never allocates
+    int numColumns = 0;
+    
+    float readBlock[readBlockSize];
+    
+    // the same transform size as the spectral nodes, so the shared FFT plan and window fit
+    static constexpr int fftSize = SpectrumCache::fftSize;
+    static constexpr int numBins = SpectrumCache::numBins;
+    
+    float fftFifo[fftSize];
+    int fftFifoIndex = 0;
+    float fftData[fftSize * 2];
+    float spectrumDb[numBins]; // falls back slowly after each peak, so it can be read by eye
+    
+    static constexpr float minDb = -96.0f;
+    static constexpr float dbFallPerTick = 3.0f;
+    static constexpr float minFrequency = 20.0f;
+    
+    juce::Path graphPath; // cleared rather than made for each paint, so it keeps its storage
+    
+    juce::SharedResourcePointer<SharedResources> shared;
+    
+    std::shared_ptr<DataManager> dataManager;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioProbeContent)
+};
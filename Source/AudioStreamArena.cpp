@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+  
+    AudioStreamArena.cpp
+    Created: 19 Oct 2026 5:31:09pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include "AudioStreamArena.h"
+
+void AudioStreamArena::prepare(int numChannels_, int samplesPerBlock_, bool useDoublePrecision_)
+{
+    numChannels = numChannels_;
+    samplesPerBlock = samplesPerBlock_;
+    useDoublePrecision = useDoublePrecision_;
+    
+    for (auto slot : slots)
+        allocate(*slot);
+}
+
+template <>
+float* const* AudioStreamArena::getChannels<float>(int slot)
+{
+    return getSlot(slot).floatChannels.get();
+}
+
+template <>
+double* const* AudioStreamArena::getChannels<double>(int slot)
+{
+    jassert(useDoublePrecision); // there isn't room for doubles
+    
+    return getSlot(slot).doubleChannels.get();
+}
+
+AudioStreamArena::Slot& AudioStreamArena::getSlot(int slot)
+{
+    while (slots.size() <= slot)
+        allocate(*slots.add(new Slot()));
+    
+    return *slots[slot];
+}
+
+void AudioStreamArena::allocate(Slot& slot)
+{
+    const int bytesPerSample = useDoublePrecision ? (int) sizeof(double) : (int) sizeof(float);
+    const int stride = (samplesPerBlock * bytesPerSample + alignment - 1) / alignment * alignment; // bytes
+    
+    // over-allocate by one alignment so the first channel can be moved up onto a boundary
+    slot.memory.allocate((size_t) (numChannels * stride + alignment), true);
+    slot.floatChannels.allocate((size_t) juce::jmax(1, numChannels), true);
+    slot.doubleChannels.allocate((size_t) juce::jmax(1, numChannels), true);
+    
+    auto first = juce::snapPointerToAlignment(slot.memory.get(), (size_t) alignment);
+    
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        slot.floatChannels[channel] = (float*) (first + channel * stride);
+        slot.doubleChannels[channel] = useDoublePrecision ? (double*) (first + channel * stride) : nullptr;
+    }
+}
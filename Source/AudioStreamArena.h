@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+  
+    AudioStreamArena.h
+    Created: 19 Oct 2026 5:31:09pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ The sample memory behind every audio stream, owned by the DataManager and shared by both of its instances.
+ Only the active instance ever processes audio, so audio stream n of each instance refers to the same slot n here rather than each instance keeping its own buffers; swapping instances hands the memory over instead of leaving a second copy idle. Every node that writes an audio stream writes the whole block before anything reads it, so whatever the other instance left in a slot never reaches the output.
+ Slots are made the first time they're asked for and then kept, so the memory behind a stream the active instance is reading never moves while the other instance is being edited. Every channel starts on a 64 byte boundary and is padded to a multiple of 64 bytes, so SIMD loads and stores are always aligned.
+ The arena is sized for one sample type at a time, chosen by prepare(); float channels can always be read from it, double channels only once it's been prepared for doubles.
+ */
+class AudioStreamArena
+{
+public:
+    static constexpr int alignment = 64; // bytes
+    
+    void prepare(int numChannels, int samplesPerBlock, bool useDoublePrecision); // reallocates every slot made so far; not while processing
+    
+    template <typename SampleType>
+    SampleType* const* getChannels(int slot); // message thread; makes the slot if it doesn't exist yet
+    
+    int getNumChannels() {return numChannels;}
+    int getNumSamples() {return samplesPerBlock;}
+    
+private:
+    struct Slot
+    {
+        juce::HeapBlock<char> memory;
+        juce::HeapBlock<float*> floatChannels;
+        juce::HeapBlock<double*> doubleChannels;
+    };
+    
+    Slot& getSlot(int slot);
+    void allocate(Slot& slot);
+    
+    juce::OwnedArray<Slot> slots;
+    
+    int numChannels = 0;
+    int samplesPerBlock = 0;
+    bool useDoublePrecision = false;
+};
+
+template <> float* const* AudioStreamArena::getChannels<float>(int slot);
+template <> double* const* AudioStreamArena::getChannels<double>(int slot);
@@ -15,7 +15,9 @@
 namespace Common {
 
 struct Node {
-    std::unique_ptr<GraphNode> component;
+    std::unique_ptr<GraphNode> component; // only while the node is on screen and the view is zoomed in far enough to use it; otherwise the node container draws it
+    int uid;
+    juce::Rectangle<int> bounds; // in graph space; follows the component while it's being dragged
 };
 
 }
@@ -9,6 +9,8 @@
 */
 #include <JuceHeader.h>
 #include "DataManager.h"
+#include "HostParameters.h"
+#include "EditHistory.h"
 
 
 const Data::Node::Defaults Data::MainInputNode::defaults = {"Main Input", false, true};
@@ -16,8 +18,14 @@ const Data::Node::Defaults Data::MainOutputNode::defaults = {"Main Output", true
 const Data::Node::Defaults Data::GainNode::defaults = {"Gain", true, true};
 const Data::Node::Defaults Data::LevelNode::defaults = {"Level", true, true};
 const Data::Node::Defaults Data::CorrelationNode::defaults = {"Correlation", true, true};
+const Data::Node::Defaults Data::WidthNode::defaults = {"Width", true, true};
 const Data::Node::Defaults Data::LoudnessNode::defaults = {"Loudness", true, true};
 const Data::Node::Defaults Data::MathsNode::defaults = {"Maths", true, true};
+const Data::Node::Defaults Data::BandEnergyNode::defaults = {"Band Energy", true, true};
+const Data::Node::Defaults Data::SpectralFeaturesNode::defaults = {"Spectral Features", true, true};
+const Data::Node::Defaults Data::ParameterOutputNode::defaults = {"Parameter Output", true, false};
+const Data::Node::Defaults Data::ParameterInputNode::defaults = {"Parameter Input", false, true};
+const Data::Node::Defaults Data::MidiOutputNode::defaults = {"MIDI Output", true, false};
 
 void Data::DataInstance::prepareStreams()
 {
@@ -114,59 +122,651 @@ void Data::DataInstance::prepareStreams()
 
 void Data::DataInstance::prepare()
 {
-    prepareStreams(); // for now just this, but later also include any pre-calc for evaluation of nodes
+    prepareStreams();
+    
+    // allocate a spectrum for every audio stream read by a spectral node, and free any that are no longer read
+    
+    bool needsSpectrum[NUM_AUDIO_STREAMS] = {};
+    
+    for (int nodeId = 0; nodeId < NUM_NODES; nodeId++)
+    {
+        if (nodes[nodeId] == nullptr || !nodes[nodeId]->isActive) break;
+        
+        auto type = nodes[nodeId]->getType();
+        
+        if (type != NodeType::BandEnergy && type != NodeType::SpectralFeatures) continue;
+        
+        int streamId = nodes[nodeId]->inputParams[0].streamId;
+        
+        if (streamId != -1) needsSpectrum[streamId] = true;
+    }
     
+    for (int streamId = 0; streamId < NUM_AUDIO_STREAMS; streamId++)
+    {
+        if (!needsSpectrum[streamId])
+        {
+            audioStreams[streamId].spectrum.reset();
+            continue;
+        }
+        
+        if (audioStreams[streamId].spectrum == nullptr)
+            audioStreams[streamId].spectrum.reset(new SpectrumCache(sampleRate));
+        
+        audioStreams[streamId].spectrumBlockIndex = -1;
+    }
+    
+    // meters copied from the other instance, or just added, haven't been set up for the bus yet
+    
+    for (int nodeId = 0; nodeId < NUM_NODES; nodeId++)
+    {
+        if (nodes[nodeId] == nullptr || !nodes[nodeId]->isActive) break;
+        
+        if (nodes[nodeId]->getType() == NodeType::Loudness)
+            static_cast<LoudnessNode*>(nodes[nodeId])->prepareMeter(sampleRate, samplesPerBlock, loudnessChannelWeights);
+    }
+    
+    // likewise allocate a ramp for every value stream read at audio rate
+    
+    bool needsRamp[NUM_VALUE_STREAMS] = {};
+    
+    for (int nodeId = 0; nodeId < NUM_NODES; nodeId++)
+    {
+        if (nodes[nodeId] == nullptr || !nodes[nodeId]->isActive) break;
+        
+        int paramId;
+        
+        switch (nodes[nodeId]->getType())
+        {
+            case NodeType::Gain: paramId = 1; break;
+            case NodeType::MidiOutput: paramId = 0; break;
+            default: continue;
+        }
+        
+        if (nodes[nodeId]->inputParams[paramId].isConst) continue;
+        
+        int streamId = nodes[nodeId]->inputParams[paramId].streamId;
+        
+        if (streamId != -1) needsRamp[streamId] = true;
+    }
+    
+    for (int streamId = 0; streamId < NUM_VALUE_STREAMS; streamId++)
+    {
+        auto& stream = valueStreams[streamId];
+        
+        stream.ramp.setSize(needsRamp[streamId] ? 2 : 0, needsRamp[streamId] ? samplesPerBlock : 0);
+        stream.resetRamps();
+    }
+    
+    prepareRampIndices();
+    
+    prepareAudioStreamBuffers();
+    
+    compile();
+}
+
+void Data::DataInstance::prepareAudioStreamBuffers()
+{
+    for (int streamId = 0; streamId < NUM_AUDIO_STREAMS; streamId++)
+    {
+        auto& stream = audioStreams[streamId];
+        
+        stream.isSilent = false; // until its producer has written it again
+        
+        // only the buffer of the precision being processed refers to anything
+        if (useDoublePrecision)
+            stream.buffer = juce::AudioBuffer<float>();
+        else
+            stream.doubleBuffer = juce::AudioBuffer<double>();
+        
+        if (!isStreamInUse(ParameterType::Audio, streamId) || numChannels == 0)
+        {
+            stream.buffer = juce::AudioBuffer<float>(); // refers to nothing
+            stream.doubleBuffer = juce::AudioBuffer<double>();
+            continue;
+        }
+        
+        // stream ids are arena slots, so both instances share the memory behind each id
+        if (useDoublePrecision)
+            referToArena(stream.doubleBuffer, arena->getChannels<double>(streamId));
+        else
+            referToArena(stream.buffer, arena->getChannels<float>(streamId));
+    }
+    
+    // the float copy of a double stream that meters read
+    analysisBuffer.setSize(useDoublePrecision ? numChannels : 0, useDoublePrecision ? samplesPerBlock : 0);
 }
 
-void Data::DataInstance::evaluate(int streamId, ParameterType type)
+template <typename SampleType>
+void Data::DataInstance::referToArena(juce::AudioBuffer<SampleType>& buffer, SampleType* const* channels)
 {
-    if (streamId == -1) return;
+    if (buffer.getNumChannels() == numChannels && buffer.getNumSamples() == samplesPerBlock && buffer.getReadPointer(0) == channels[0]) return;
     
-    if (type == ParameterType::Audio)
+    buffer.setDataToReferTo(const_cast<SampleType**>(channels), numChannels, samplesPerBlock);
+}
+
+bool Data::DataInstance::isStreamInUse(ParameterType type, int streamId)
+{
+    Stream& stream = type == ParameterType::Audio ? (Stream&) audioStreams[streamId] : (Stream&) valueStreams[streamId];
+    
+    return stream.inputNodeId != -1 && stream.outputNodeId != -1;
+}
+
+std::vector<double> Data::DataInstance::getLoudnessChannelWeights(const juce::AudioChannelSet& channelSet)
+{
+    std::vector<double> weights;
+    
+    for (auto type : channelSet.getChannelTypes())
     {
-        evaluate(audioStreams[streamId].inputNodeId);
-    } else if (type == ParameterType::Value)
+        switch (type)
+        {
+            case juce::AudioChannelSet::LFE:
+            case juce::AudioChannelSet::LFE2:
+                weights.push_back(0.0);
+                break;
+            // only the surrounds either side of the listener (around 110 degrees for 5.1, 90 for the sides of 7.1) are boosted; rears and heights aren't
+            case juce::AudioChannelSet::leftSurround:
+            case juce::AudioChannelSet::rightSurround:
+            case juce::AudioChannelSet::leftSurroundSide:
+            case juce::AudioChannelSet::rightSurroundSide:
+                weights.push_back(1.41);
+                break;
+            default:
+                weights.push_back(1.0);
+                break;
+        }
+    }
+    
+    return weights;
+}
+
+void Data::DataInstance::prepareToPlay(double sampleRate_, const juce::AudioChannelSet& channelSet_, int samplesPerBlock_, bool useDoublePrecision_)
+{
+    sampleRate = sampleRate_;
+    samplesPerBlock = samplesPerBlock_;
+    channelSet = channelSet_;
+    numChannels = channelSet.size();
+    loudnessChannelWeights = getLoudnessChannelWeights(channelSet);
+    useDoublePrecision = useDoublePrecision_;
+    
+    // the arena has just been reallocated (zeroed), so every buffer in use has to be pointed at it again
+    prepareAudioStreamBuffers();
+    
+    for (int i = 0; i < NUM_AUDIO_STREAMS; i++)
+    {
+        if (audioStreams[i].spectrum != nullptr)
+        {
+            audioStreams[i].spectrum->setSampleRate(sampleRate);
+            audioStreams[i].spectrum->reset();
+        }
+    }
+    
+    for (int nodeId = 0; nodeId < NUM_NODES; nodeId++)
+    {
+        if (nodes[nodeId] == nullptr || !nodes[nodeId]->isActive) break;
+        
+        if (nodes[nodeId]->getType() == NodeType::Loudness)
+            static_cast<LoudnessNode*>(nodes[nodeId])->prepareMeter(sampleRate, samplesPerBlock, loudnessChannelWeights);
+    }
+    
+    // prepare the envelopes of the value streams:
+    
+    envelopes.setBlockRate(sampleRate / samplesPerBlock);
+    
+    for (int i = 0; i < NUM_VALUE_STREAMS; i++)
+    {
+        if (valueStreams[i].ramp.getNumChannels() == 0) continue;
+        
+        valueStreams[i].ramp.setSize(2, samplesPerBlock);
+        valueStreams[i].resetRamps();
+    }
+    
+    prepareRampIndices();
+}
+
+void Data::DataInstance::prepareRampIndices()
+{
+    if (numRampIndices == samplesPerBlock) return;
+    
+    rampIndices.allocate((size_t) samplesPerBlock, false);
+    
+    for (int i = 0; i < samplesPerBlock; i++)
+        rampIndices[i] = (float) (i + 1);
+    
+    numRampIndices = samplesPerBlock;
+}
+
+void Data::DataInstance::writeSilence(const CompiledNode& compiledNode, int paramId)
+{
+    auto& output = compiled.getOutput(compiledNode, paramId);
+    
+    for (int i = 0; i < output.numStreams; i++)
+    {
+        auto& stream = audioStreams[compiled.outputStreamIds[output.firstStream + i]];
+        
+        if (stream.isSilent) continue; // still all zeros from last block
+        
+        stream.buffer.clear(); // whichever buffer isn't being used is empty, so clearing it costs nothing
+        stream.doubleBuffer.clear();
+        stream.isSilent = true;
+    }
+}
+
+void Data::DataInstance::setNotSilent(const CompiledNode& compiledNode, int paramId)
+{
+    auto& output = compiled.getOutput(compiledNode, paramId);
+    
+    for (int i = 0; i < output.numStreams; i++)
+        audioStreams[compiled.outputStreamIds[output.firstStream + i]].isSilent = false;
+}
+
+const juce::AudioBuffer<float>& Data::DataInstance::getAnalysisBuffer(int streamId)
+{
+    auto& stream = audioStreams[streamId];
+    
+    if (!useDoublePrecision) return stream.buffer;
+    
+    // the meters and FFT only take floats; the audio path itself never comes through here, so it stays in doubles
+    for (int channel = 0; channel < stream.doubleBuffer.getNumChannels(); channel++)
+    {
+        auto dest = analysisBuffer.getWritePointer(channel);
+        auto src = stream.doubleBuffer.getReadPointer(channel);
+        
+        for (int sample = 0; sample < analysisBuffer.getNumSamples(); sample++)
+            dest[sample] = (float) src[sample];
+    }
+    
+    return analysisBuffer;
+}
+
+SpectrumCache* Data::DataInstance::getSpectrum(int streamId)
+{
+    if (streamId == -1) return nullptr;
+    
+    auto& stream = audioStreams[streamId];
+    
+    if (stream.spectrum == nullptr) return nullptr; // prepare() hasn't been called since this was connected
+    
+    if (stream.spectrumBlockIndex != blockIndex)
     {
-        evaluate(valueStreams[streamId].inputNodeId);
+        stream.spectrum->push(getAnalysisBuffer(streamId), stream.isSilent);
+        stream.spectrumBlockIndex = blockIndex;
     }
     
+    return stream.spectrum.get();
 }
 
-void Data::DataInstance::evaluate(int nodeId)
+const float* Data::DataInstance::getRamp(int streamId, bool asGain, int numSamples)
 {
-    if (nodeId == -1) return;
+    auto& stream = valueStreams[streamId];
+    
+    if (numSamples <= 0 || stream.ramp.getNumChannels() < 2 || stream.ramp.getNumSamples() < numSamples || numRampIndices < numSamples) return nullptr; // prepare() hasn't been called since this was connected
+    
+    const int form = asGain ? 1 : 0;
+    float* ramp = stream.ramp.getWritePointer(form);
+    
+    if (stream.rampBlockIndex[form] == blockIndex) return ramp;
+    
+    // whether the ramp can carry on from where it ended last block
+    const bool continues = stream.rampBlockIndex[form] == blockIndex - 1;
+    
+    float start = stream.getPrevValue();
+    float end = stream.rampShape == RampShape::RampOnePole ? stream.getTarget() : stream.getValue();
+    
+    if (asGain)
+    {
+        start = juce::Decibels::decibelsToGain(start);
+        end = juce::Decibels::decibelsToGain(end);
+    }
+    
+    switch (stream.rampShape)
+    {
+        case RampShape::RampDecibelLinear:
+        {
+            if (start * end > 0) // can't be interpolated in decibels across zero
+            {
+                // equal steps in decibels are equal ratios in gain. Each chunk starts from a closed form value and is
+                // filled by multiplying a table of the ratio's powers, so the error can't build up across a large block
+                const double logRatio = std::log((double) end / (double) start) / (double) numSamples;
+                
+                float powers[rampChunkSize]; // ratio^1 to ratio^rampChunkSize
+                
+                for (int i = 0; i < rampChunkSize; i++)
+                    powers[i] = (float) std::exp(logRatio * (i + 1));
+                
+                for (int chunkStart = 0; chunkStart < numSamples; chunkStart += rampChunkSize)
+                {
+                    const float chunkBase = (float) (start * std::exp(logRatio * chunkStart));
+                    
+                    juce::FloatVectorOperations::copyWithMultiply(ramp + chunkStart, powers, chunkBase, juce::jmin(rampChunkSize, numSamples - chunkStart));
+                }
+                
+                ramp[numSamples - 1] = end;
+                break;
+            }
+        }
+            [[fallthrough]];
+        case RampShape::RampLinear:
+        {
+            // start + increment * (i + 1), so the ramp carries on from the last block's end and lands on this one's
+            juce::FloatVectorOperations::copyWithMultiply(ramp, rampIndices.get(), (end - start) / (float) numSamples, numSamples);
+            juce::FloatVectorOperations::add(ramp, start, numSamples);
+            
+            ramp[numSamples - 1] = end;
+        }
+            break;
+        case RampShape::RampOnePole:
+        {
+            // smooths towards the stream's target at audio rate, rather than following the block rate envelope
+            float value = continues ? stream.rampEnd[form] : start;
+            
+            const float coef = Envelope::getCoefficient(end > value ? stream.getMsAttack() : stream.getMsRelease(), (float) sampleRate);
+            
+            for (int i = 0; i < numSamples; i++)
+            {
+                value = end + coef * (value - end);
+                ramp[i] = value;
+            }
+        }
+            break;
+    }
+    
+    stream.rampEnd[form] = ramp[numSamples - 1];
+    stream.rampBlockIndex[form] = blockIndex;
+    
+    return ramp;
+}
+
+float Data::DataInstance::getInputValue(const CompiledNode& compiledNode, int paramId, float fallback)
+{
+    if (paramId >= compiledNode.numInputs) return fallback;
+    
+    auto& input = compiled.getInput(compiledNode, paramId);
+    
+    if (input.isConst) return input.constValue;
+    
+    if (input.streamId == -1) return fallback;
+    
+    return valueStreams[input.streamId].getValue();
+}
+
+void Data::DataInstance::setOutputValue(const CompiledNode& compiledNode, int paramId, float value)
+{
+    if (paramId >= compiledNode.numOutputs) return;
+    
+    auto& output = compiled.getOutput(compiledNode, paramId);
+    
+    for (int i = 0; i < output.numStreams; i++)
+        valueStreams[compiled.outputStreamIds[output.firstStream + i]].setValue(value);
+}
+
+void Data::DataInstance::compile()
+{
+    char visitState[NUM_NODES] = {}; // 0 not yet visited, 1 being placed, 2 placed
+    
+    compiled.numNodes = 0;
+    compiled.numInputs = 0;
+    compiled.numOutputs = 0;
+    compiled.numOutputStreams = 0;
+    compiled.numValueStreams = 0;
+    
+    compile(1, visitState); // the main output
+    
+    // nodes with no outputs can't be reached from the main output, so they end the graph as well
+    for (int nodeId = 0; nodeId < NUM_NODES; nodeId++)
+    {
+        if (nodes[nodeId] == nullptr || !nodes[nodeId]->isActive) break;
+        
+        if (!nodes[nodeId]->hasOutputSide && !nodes[nodeId]->isGlobalLockedNode) compile(nodeId, visitState);
+    }
+    
+    // audio only passes through gains, so it stops as soon as the input does. Only what the graph sends as parameters or MIDI can carry on:
+    // for as long as the slowest analysis takes to see nothing but silence, then for the slowest envelope to settle after that
+    
+    bool hasValueOutputs = false;
+    double analysisSeconds = 0.0;
+    
+    for (int i = 0; i < compiled.numNodes; i++)
+    {
+        switch (compiled.nodes[i].type)
+        {
+            case NodeType::ParameterOutput:
+            case NodeType::MidiOutput:
+                hasValueOutputs = true;
+                break;
+            case NodeType::Loudness:
+                analysisSeconds = juce::jmax(analysisSeconds, LoudnessNode::settleSeconds);
+                break;
+            case NodeType::BandEnergy:
+            case NodeType::SpectralFeatures:
+                analysisSeconds = juce::jmax(analysisSeconds, SpectrumCache::settleSamples / sampleRate);
+                break;
+            default:
+                break;
+        }
+    }
+    
+    double envelopeSeconds = 0.0;
+    
+    for (int streamId = 0; streamId < NUM_VALUE_STREAMS; streamId++)
+    {
+        if (!isStreamInUse(ParameterType::Value, streamId)) continue;
+        
+        const double ms = juce::jmax(valueStreams[streamId].getMsAttack(), valueStreams[streamId].getMsRelease());
+        envelopeSeconds = juce::jmax(envelopeSeconds, ms * envelopeSettleTimeConstants * 0.001);
+    }
+    
+    tailSeconds = hasValueOutputs ? analysisSeconds + envelopeSeconds : 0.0;
+}
+
+void Data::DataInstance::compile(int nodeId, char* visitState)
+{
+    if (nodeId == -1 || nodes[nodeId] == nullptr) return;
+    
+    if (visitState[nodeId] != 0) return; // already placed, or reached again through a cycle
+    
+    visitState[nodeId] = 1;
     
     Data::Node* node = nodes[nodeId];
     
-    for (int i = 0; i < NUM_PARAMS; i++)
+    // place every node this one reads from before it
+    
+    for (int paramId = 0; paramId < NUM_PARAMS; paramId++)
+    {
+        auto& param = node->inputParams[paramId];
+        
+        if (!param.isActive) break;
+        
+        if (param.isConst || param.streamId == -1) continue;
+        
+        compile(param.type == ParameterType::Audio ? audioStreams[param.streamId].inputNodeId : valueStreams[param.streamId].inputNodeId, visitState);
+    }
+    
+    visitState[nodeId] = 2;
+    
+    auto& compiledNode = compiled.nodes[compiled.numNodes++];
+    
+    compiledNode.node = node;
+    compiledNode.nodeId = nodeId;
+    compiledNode.type = node->getType();
+    compiledNode.firstInput = compiled.numInputs;
+    compiledNode.numInputs = 0;
+    compiledNode.firstOutput = compiled.numOutputs;
+    compiledNode.numOutputs = 0;
+    compiledNode.firstValueStream = compiled.numValueStreams;
+    compiledNode.numValueStreams = 0;
+    
+    for (int paramId = 0; paramId < NUM_PARAMS; paramId++)
+    {
+        auto& param = node->inputParams[paramId];
+        
+        if (!param.isActive) break;
+        
+        auto& input = compiled.inputs[compiled.numInputs++];
+        
+        input.isConst = param.isConst;
+        input.constValue = param.isConst ? param.constValue : 0.0f;
+        input.streamId = param.isConst ? -1 : param.streamId;
+        
+        compiledNode.numInputs++;
+    }
+    
+    for (int paramId = 0; paramId < NUM_PARAMS; paramId++)
+    {
+        auto& param = node->outputParams[paramId];
+        
+        if (!param.isActive) break;
+        
+        auto& output = compiled.outputs[compiled.numOutputs++];
+        
+        output.firstStream = compiled.numOutputStreams;
+        output.numStreams = 0;
+        
+        for (int streamId : param.streamIds)
+        {
+            if (streamId == -1) break;
+            
+            compiled.outputStreamIds[compiled.numOutputStreams++] = streamId;
+            output.numStreams++;
+            
+            if (param.type == ParameterType::Value)
+            {
+                compiled.valueStreamIds[compiled.numValueStreams++] = streamId;
+                compiledNode.numValueStreams++;
+            }
+        }
+        
+        compiledNode.numOutputs++;
+    }
+}
+
+// multiplies src by a per-sample gain; the ramps are always floats, so doubles can't use FloatVectorOperations
+template <typename SampleType>
+static void multiplyByRamp(SampleType* dest, const SampleType* src, const float* ramp, int numSamples)
+{
+    if constexpr (std::is_same<SampleType, float>::value)
+    {
+        juce::FloatVectorOperations::multiply(dest, src, ramp, numSamples);
+    } else
+    {
+        for (int sample = 0; sample < numSamples; sample++)
+            dest[sample] = src[sample] * (SampleType) ramp[sample];
+    }
+}
+
+// the sums of a*b, a*a and b*b over two channels, for correlation and width. Audio buffers are planar, so this runs along the samples of each channel rather than across channels;
+// the arena keeps every channel SIMD aligned, but anything else falls back to the scalar loop
+template <typename SampleType>
+static void sumChannelPair(const SampleType* a, const SampleType* b, int numSamples, SampleType& ab, SampleType& aa, SampleType& bb)
+{
+    ab = aa = bb = 0;
+    
+    int sample = 0;
+    
+   #if JUCE_USE_SIMD
+    using Register = juce::dsp::SIMDRegister<SampleType>;
+    constexpr int step = (int) Register::SIMDNumElements;
+    
+    if (Register::isSIMDAligned(a) && Register::isSIMDAligned(b))
     {
-        if (node->getType() == NodeType::MainInput) break;
+        auto sumAB = Register::expand(0);
+        auto sumAA = Register::expand(0);
+        auto sumBB = Register::expand(0);
         
-        if (!node->inputParams[i].isActive) break;
+        for (; sample + step <= numSamples; sample += step)
+        {
+            auto x = Register::fromRawArray(a + sample);
+            auto y = Register::fromRawArray(b + sample);
+            
+            sumAB += x * y;
+            sumAA += x * x;
+            sumBB += y * y;
+        }
         
-        if (!node->inputParams[i].isConst && node->inputParams[i].streamId != -1)
+        ab = sumAB.sum();
+        aa = sumAA.sum();
+        bb = sumBB.sum();
+    }
+   #endif
+    
+    for (; sample < numSamples; sample++)
+    {
+        ab += a[sample] * b[sample];
+        aa += a[sample] * a[sample];
+        bb += b[sample] * b[sample];
+    }
+}
+
+template <typename SampleType>
+static SampleType sumOfSquares(const SampleType* src, int numSamples)
+{
+    SampleType sum = 0;
+    
+    int sample = 0;
+    
+   #if JUCE_USE_SIMD
+    using Register = juce::dsp::SIMDRegister<SampleType>;
+    constexpr int step = (int) Register::SIMDNumElements;
+    
+    if (Register::isSIMDAligned(src))
+    {
+        auto sumRegister = Register::expand(0);
+        
+        for (; sample + step <= numSamples; sample += step)
         {
-            evaluate(node->inputParams[i].streamId, node->inputParams[i].type);
+            auto x = Register::fromRawArray(src + sample);
+            sumRegister += x * x;
         }
+        
+        sum = sumRegister.sum();
     }
+   #endif
     
-    // then evaluate internal node logic
+    for (; sample < numSamples; sample++)
+        sum += src[sample] * src[sample];
     
-    switch (node->getType()) {
+    return sum;
+}
+
+// a channel index from a value input, so any pair of channels in the bus can be compared
+static int getChannelIndex(float value, int numChannels)
+{
+    return juce::jlimit(0, juce::jmax(0, numChannels - 1), juce::roundToInt(value));
+}
+
+template <typename SampleType>
+void Data::DataInstance::evaluate(const CompiledNode& compiledNode)
+{
+    Data::Node* node = compiledNode.node; // only for the state some nodes keep, e.g. meters
+    
+    switch (compiledNode.type) {
         case NodeType::MainInput:
         {
             MainInputNode* mainInputNode = static_cast<MainInputNode*>(node);
+            auto* mainInput = mainInputNode->getMainInput<SampleType>();
+            auto& output = compiled.getOutput(compiledNode, 0);
+            
+            if (mainInput == nullptr) break;
+            
+            bool inputIsSilent = true;
+            
+            for (int channel = 0; channel < mainInput->getNumChannels() && inputIsSilent; channel++)
+                inputIsSilent = mainInput->getMagnitude(channel, 0, mainInput->getNumSamples()) == (SampleType) 0;
             
-            for (int outputIdId = 0; outputIdId < 8; outputIdId++)
+            if (inputIsSilent)
             {
-                int outputId = mainInputNode->outputParams[0].streamIds[outputIdId];
-                
-                if (outputId == -1) break;
-                auto* output = &audioStreams[outputId].buffer;
+                writeSilence(compiledNode, 0);
+                break;
+            }
+            
+            setNotSilent(compiledNode, 0);
+            
+            for (int i = 0; i < output.numStreams; i++)
+            {
+                auto* buffer = &audioStreams[compiled.outputStreamIds[output.firstStream + i]].getBuffer<SampleType>();
                 
-                for (int channel = 0; channel < mainInputNode->mainInput->getNumChannels(); channel++)
+                for (int channel = 0; channel < mainInput->getNumChannels(); channel++)
                 {
-                    output->copyFrom(channel, 0, *mainInputNode->mainInput, channel, 0, mainInputNode->mainInput->getNumSamples());
+                    buffer->copyFrom(channel, 0, *mainInput, channel, 0, mainInput->getNumSamples());
                 }
             }
         }
@@ -175,41 +775,45 @@ void Data::DataInstance::evaluate(int nodeId)
             break;
         case NodeType::Gain:
         {
-            int inputStreamId = node->inputParams[0].streamId;
-            int gainStreamId = node->inputParams[1].streamId;
+            int inputStreamId = compiled.getInput(compiledNode, 0).streamId;
+            auto& gainInput = compiled.getInput(compiledNode, 1);
+            
+            auto& output = compiled.getOutput(compiledNode, 0);
             
-            if (inputStreamId == -1) break; // no point doing anything
+            if (isSilent(inputStreamId))
+            { // no input is silence too; arena memory may hold another stream's audio, so it can't just be left
+                writeSilence(compiledNode, 0);
+                break;
+            }
             
-            float gain;
+            setNotSilent(compiledNode, 0);
             
-            float prevGain;
+            auto& input = audioStreams[inputStreamId].getBuffer<SampleType>();
+            const int blockLength = juce::jmin(numSamples, input.getNumSamples()); // the host's block, which can be shorter than the streams
             
-            if (node->inputParams[1].isConst)
+            const float* gainRamp = nullptr; // shared with any other gain reading the stream this block
+            float gain = 0;
+            
+            if (gainInput.isConst)
             {
-                gain = node->inputParams[1].constValue;
-                prevGain = gain; // not much i can think of to do about this really
-            } else if (gainStreamId != -1) {
-                gain = valueStreams[gainStreamId].value;
-                prevGain = valueStreams[gainStreamId].prevValue;
-            } else {
-                gain = 0;
-                prevGain = 0;
+                gain = gainInput.constValue;
+            } else if (gainInput.streamId != -1) {
+                gainRamp = getRamp(gainInput.streamId, true, blockLength);
+                gain = valueStreams[gainInput.streamId].getValue(); // only used if the ramp isn't ready
             }
             
             gain = juce::Decibels::decibelsToGain(gain);
-            prevGain = juce::Decibels::decibelsToGain(prevGain);
-            
-            auto input = audioStreams[node->inputParams[0].streamId].buffer;
             
-            for (int outputId : node->outputParams[0].streamIds)
+            for (int i = 0; i < output.numStreams; i++)
             {
-                if (outputId == -1) break;
-                auto* output = &audioStreams[outputId].buffer;
+                auto* buffer = &audioStreams[compiled.outputStreamIds[output.firstStream + i]].getBuffer<SampleType>();
             
                 for (int channel = 0; channel < input.getNumChannels(); channel++)
-                {   
-                    output->copyFrom(channel, 0, input, channel, 0, input.getNumSamples());
-                    output->applyGainRamp(channel, 0, output->getNumSamples(), prevGain, gain);
+                {
+                    if (gainRamp != nullptr)
+                        multiplyByRamp(buffer->getWritePointer(channel), input.getReadPointer(channel), gainRamp, blockLength);
+                    else
+                        juce::FloatVectorOperations::copyWithMultiply(buffer->getWritePointer(channel), input.getReadPointer(channel), (SampleType) gain, blockLength);
                 }
             }
         }
@@ -217,151 +821,111 @@ void Data::DataInstance::evaluate(int nodeId)
         case NodeType::Level: // TODO: seems to read lower than in logic? idk what's going on here
             //TODO: also maybe add peak/true peak options for funsies
         {
-            int inputStreamId = node->inputParams[0].streamId;
+            int inputStreamId = compiled.getInput(compiledNode, 0).streamId;
             
-            if (inputStreamId == -1) {
-                for (int streamId : node->outputParams[0].streamIds) // lin
-                {
-                    if (streamId == -1) break;
-                    valueStreams[streamId].setValue(0);
-                }
-                
-                for (int streamId : node->outputParams[1].streamIds) // gain
-                {
-                    if (streamId == -1) break;
-                    valueStreams[streamId].setValue(-INFINITY);
-                }
+            if (isSilent(inputStreamId)) {
+                setOutputValue(compiledNode, 0, 0); // lin
+                setOutputValue(compiledNode, 1, juce::Decibels::gainToDecibels(0.0f)); // gain, the same -100dB floor as below, since -inf would turn the envelopes reading it into NaN
                 break;
             }
             
-            auto input = audioStreams[inputStreamId].buffer;
+            auto& input = audioStreams[inputStreamId].getBuffer<SampleType>();
+            
+            const int numSamples = input.getNumSamples();
             
             float total = 0;
             
             for (int channel = 0; channel < input.getNumChannels(); channel++)
             {
-                total += input.getRMSLevel(channel, 0, input.getNumSamples());
+                total += (float) std::sqrt(sumOfSquares(input.getReadPointer(channel), numSamples) / (SampleType) numSamples);
             }
             
             total /= input.getNumChannels();
-
             
-            for (int streamId : node->outputParams[0].streamIds)
-            {
-                if (streamId == -1) break;
-                valueStreams[streamId].setValue(total);
-            }
-            
-            total = juce::Decibels::gainToDecibels(total);
-            
-            for (int streamId : node->outputParams[1].streamIds)
-            {
-                if (streamId == -1) break;
-                valueStreams[streamId].setValue(total);
-            }
+            setOutputValue(compiledNode, 0, total);
+            setOutputValue(compiledNode, 1, juce::Decibels::gainToDecibels(total));
         }
             break;
         case NodeType::Correlation:
         {
-            int inputStreamId = node->inputParams[0].streamId;
+            int inputStreamId = compiled.getInput(compiledNode, 0).streamId;
             
-            if (inputStreamId == -1) {
-                for (int streamId : node->outputParams[0].streamIds)
-                {
-                    if (streamId == -1) break;
-                    valueStreams[streamId].setValue(0);
-                }
+            if (isSilent(inputStreamId)) { // uncorrelated rather than 0/0
+                setOutputValue(compiledNode, 0, 0);
                 break;
             }
             
-            auto input = audioStreams[inputStreamId].buffer;
+            auto& input = audioStreams[inputStreamId].getBuffer<SampleType>();
             
-            if (input.getNumChannels() != 2)
-            {
-                for (int streamId : node->outputParams[0].streamIds)
-                {
-                    if (streamId == -1) break;
-                    valueStreams[streamId].setValue(0);
-                }
-                break;
-            }
+            // any two channels of the bus, left and right by default
+            const int channelA = getChannelIndex(getInputValue(compiledNode, 1, 0.0f), input.getNumChannels());
+            const int channelB = getChannelIndex(getInputValue(compiledNode, 2, 1.0f), input.getNumChannels());
             
-            // then there are deffo 2 channels for stereo correlation
+            SampleType sumOfProduct, sumOfSquaresLeft, sumOfSquaresRight;
             
-            float sumOfProduct = 0.0f;
-            float sumOfSquaresLeft = 0.0f;
-            float sumOfSquaresRight = 0.0f;
+            sumChannelPair(input.getReadPointer(channelA), input.getReadPointer(channelB), input.getNumSamples(), sumOfProduct, sumOfSquaresLeft, sumOfSquaresRight);
             
-            for (int sample = 0; sample < input.getNumSamples(); ++sample)
-            {
-                float leftChannel = input.getSample(0, sample);
-                float rightChannel = input.getSample(1, sample);
-
-                sumOfProduct += leftChannel * rightChannel;
-                sumOfSquaresLeft += leftChannel * leftChannel;
-                sumOfSquaresRight += rightChannel * rightChannel;
-            }
+            SampleType sumsOfSquares = sumOfSquaresLeft * sumOfSquaresRight;
             
-            float sumsOfSquares = sumOfSquaresLeft * sumOfSquaresRight;
-
-            float correlation = sumOfProduct / sqrtf(sumsOfSquares);
+            if (sumsOfSquares <= 0) { // one side is silent
+                setOutputValue(compiledNode, 0, 0);
+                break;
+            }
 
+            float correlation = (float) (sumOfProduct / std::sqrt(sumsOfSquares));
             
-            for (int streamId : node->outputParams[0].streamIds)
-            {
-                if (streamId == -1) break;
-                valueStreams[streamId].setValue(correlation);
-            }
+            setOutputValue(compiledNode, 0, correlation);
         }
             break;
-        case NodeType::Loudness: // TODO: seems to read lower than in logic? idk what's going on here
+        case NodeType::Width:
         {
-            auto loudnessNode = static_cast<Data::LoudnessNode*>(node);
+            int inputStreamId = compiled.getInput(compiledNode, 0).streamId;
             
-//            DBG("hiii");
-            
-            int inputStreamId = loudnessNode->inputParams[0].streamId;
-            
-            if (inputStreamId == -1) 
-            {
-//                for (int streamId : loudnessNode->outputParams[0].streamIds)
-//                {
-//                    if (streamId == -1) break;
-//                    valueStreams[streamId].setValue(0);
-//                }
+            if (isSilent(inputStreamId)) {
+                setOutputValue(compiledNode, 0, 0);
                 break;
             }
             
-            auto input = audioStreams[inputStreamId].buffer;
+            auto& input = audioStreams[inputStreamId].getBuffer<SampleType>();
             
-//            DBG(input.getMagnitude(0, input.getNumSamples()));
+            const int channelA = getChannelIndex(getInputValue(compiledNode, 1, 0.0f), input.getNumChannels());
+            const int channelB = getChannelIndex(getInputValue(compiledNode, 2, 1.0f), input.getNumChannels());
             
-            loudnessNode->meter->processBlock(input);
+            SampleType ab, aa, bb;
             
+            sumChannelPair(input.getReadPointer(channelA), input.getReadPointer(channelB), input.getNumSamples(), ab, aa, bb);
             
-            float loudness = loudnessNode->meter->getShortTermLoudness();
+            // the energy of (a - b) / 2 over the energy of both, so it doesn't depend on level
+            const SampleType total = aa + bb;
             
-            for (int streamId : node->outputParams[0].streamIds)
-            {
-                if (streamId == -1) break;
-                valueStreams[streamId].setValue(loudness);
-            }
+            setOutputValue(compiledNode, 0, total > 0 ? (float) ((total - 2 * ab) / (2 * total)) : 0.0f);
+        }
+            break;
+        case NodeType::Loudness: // TODO: seems to read lower than in logic? idk what's going on here
+        {
+            auto loudnessNode = static_cast<Data::LoudnessNode*>(node);
             
-            loudness = loudnessNode->meter->getMomentaryLoudness();
+            int inputStreamId = compiled.getInput(compiledNode, 0).streamId;
             
-            for (int streamId : node->outputParams[1].streamIds)
-            {
-                if (streamId == -1) break;
-                valueStreams[streamId].setValue(loudness);
-            }
+            if (inputStreamId == -1) break;
             
-            loudness = loudnessNode->meter->getIntegratedLoudness();
-        
-            for (int streamId : node->outputParams[2].streamIds)
+            auto& input = getAnalysisBuffer(inputStreamId);
+            
+            if (audioStreams[inputStreamId].isSilent)
+            { // the readings keep falling through silence until the longest window is empty, and then they hold
+                if (loudnessNode->silentSamples >= LoudnessNode::settleSeconds * sampleRate) break;
+                
+                loudnessNode->silentSamples += input.getNumSamples();
+            } else
             {
-                if (streamId == -1) break;
-                valueStreams[streamId].setValue(loudness);
+                loudnessNode->silentSamples = 0;
             }
+            
+            loudnessNode->meter->processBlock(input);
+            
+            setOutputValue(compiledNode, 0, loudnessNode->meter->getShortTermLoudness());
+            setOutputValue(compiledNode, 1, loudnessNode->meter->getMomentaryLoudness());
+            setOutputValue(compiledNode, 2, loudnessNode->meter->getIntegratedLoudness());
         }
             break;
         case NodeType::Maths:
@@ -370,25 +934,125 @@ void Data::DataInstance::evaluate(int nodeId)
             
             // set input values based on streams
             
-            for (int paramId = 0; paramId < NUM_PARAMS; paramId++)
-            {
-                if (!mathsNode->inputParams[paramId].isActive) break;
-                
-                if (mathsNode->inputParams[paramId].isConst)
+            for (int paramId = 0; paramId < compiledNode.numInputs; paramId++)
+                mathsNode->inputs[paramId] = getInputValue(compiledNode, paramId, 0.0f);
+            
+            float value = mathsNode->getValue();
+            
+            if (!std::isfinite(value))
+            { // e.g. dividing by zero; once NaN reaches an envelope it never leaves
+                if (events != nullptr)
                 {
-                    mathsNode->inputs[paramId] = mathsNode->inputParams[paramId].constValue;
-                    continue;
+                    EngineEvent event {EngineEvent::error};
+                    event.error = EngineEvent::nonFiniteValue;
+                    event.nodeId = compiledNode.nodeId;
+                    
+                    events->push(event);
                 }
                 
-                mathsNode->inputs[paramId] = valueStreams[mathsNode->inputParams[paramId].streamId].value;
+                value = 0.0f;
             }
 
-            const float value = mathsNode->getValue();
+            setOutputValue(compiledNode, 0, value);
+        }
+            break;
+        case NodeType::BandEnergy:
+        {
+            auto spectrum = getSpectrum(compiled.getInput(compiledNode, 0).streamId);
+            
+            if (spectrum == nullptr || !spectrum->hasFrame()) break;
+            
+            float lowHz = getInputValue(compiledNode, 1, 0.0f);
+            float highHz = getInputValue(compiledNode, 2, (float) sampleRate / 2.0f);
+            
+            setOutputValue(compiledNode, 0, spectrum->getBandEnergy(lowHz, highHz));
+        }
+            break;
+        case NodeType::SpectralFeatures:
+        {
+            auto spectrum = getSpectrum(compiled.getInput(compiledNode, 0).streamId);
+            
+            if (spectrum == nullptr || !spectrum->hasFrame()) break;
             
-            for (int streamId : node->outputParams[0].streamIds)
+            setOutputValue(compiledNode, 0, spectrum->getCentroid());
+            setOutputValue(compiledNode, 1, spectrum->getFlux());
+            setOutputValue(compiledNode, 2, spectrum->getRolloff());
+            setOutputValue(compiledNode, 3, spectrum->getFlatness());
+        }
+            break;
+        case NodeType::ParameterOutput:
+        {
+            if (hostParameters == nullptr) break;
+            
+            auto& valueInput = compiled.getInput(compiledNode, 0);
+            
+            if (!valueInput.isConst && valueInput.streamId == -1) break; // nothing to publish
+            
+            const float value = getInputValue(compiledNode, 0, 0.0f);
+            const float min = getInputValue(compiledNode, 1, 0.0f);
+            const float max = getInputValue(compiledNode, 2, 1.0f);
+            
+            if (min == max) break;
+            
+            hostParameters->setOutputValue(static_cast<ParameterOutputNode*>(node)->slot, (value - min) / (max - min));
+        }
+            break;
+        case NodeType::ParameterInput:
+        {
+            if (hostParameters == nullptr) break;
+            
+            setOutputValue(compiledNode, 0, hostParameters->getInputValue(static_cast<ParameterInputNode*>(node)->slot));
+        }
+            break;
+        case NodeType::MidiOutput:
+        {
+            if (midiOutput == nullptr) break;
+            
+            auto midiNode = static_cast<MidiOutputNode*>(node);
+            auto& valueInput = compiled.getInput(compiledNode, 0);
+            
+            if (!valueInput.isConst && valueInput.streamId == -1) break; // nothing to send
+            
+            const float min = getInputValue(compiledNode, 1, 0.0f);
+            const float max = getInputValue(compiledNode, 2, 1.0f);
+            
+            if (min == max) break;
+            
+            const int blockLength = juce::jmin(numSamples, samplesPerBlock);
+            
+            // read the value at each sample an event could go at, so events land where the stream actually crosses the threshold
+            const float* ramp = valueInput.isConst ? nullptr : getRamp(valueInput.streamId, false, blockLength);
+            const float value = getInputValue(compiledNode, 0, 0.0f);
+            
+            const int maxValue = midiNode->getMaxValue();
+            const int minInterval = juce::jmax(1, juce::roundToInt(midiNode->minIntervalMs * 0.001 * sampleRate));
+            const int settleInterval = minInterval * MidiOutputNode::settleIntervals;
+            
+            int sample = 0;
+            
+            while (sample < blockLength)
             {
-                if (streamId == -1) break;
-                valueStreams[streamId].setValue(value);
+                if (midiNode->samplesSinceSent < minInterval)
+                { // skip straight to the next sample that could be sent
+                    const int skip = juce::jmin(minInterval - midiNode->samplesSinceSent, blockLength - sample);
+                    sample += skip;
+                    midiNode->samplesSinceSent += skip;
+                    continue;
+                }
+                
+                const float v = ramp != nullptr ? ramp[sample] : value;
+                const int quantised = juce::jlimit(0, maxValue, juce::roundToInt((v - min) / (max - min) * maxValue));
+                const int change = std::abs(quantised - midiNode->lastSentValue);
+                
+                if (midiNode->lastSentValue == -1 || change >= midiNode->thresholdSteps || (change > 0 && midiNode->samplesSinceSent >= settleInterval))
+                {
+                    midiNode->addMessages(*midiOutput, quantised, sample);
+                    midiNode->lastSentValue = quantised;
+                    midiNode->samplesSinceSent = 0;
+                }
+                
+                midiNode->samplesSinceSent = juce::jmin(midiNode->samplesSinceSent + 1, settleInterval);
+                sample++;
             }
         }
             break;
@@ -397,10 +1061,130 @@ void Data::DataInstance::evaluate(int nodeId)
 
 void Data::DataInstance::evaluate()
 {
-    int finalStreamId = nodes[1]->inputParams[0].streamId;
+    if (useDoublePrecision)
+        evaluate<double>();
+    else
+        evaluate<float>();
+}
+
+template <typename SampleType>
+void Data::DataInstance::evaluate()
+{
+    blockIndex++;
+    
+    // already in order, so every node's inputs have been computed and smoothed by the time it runs
+    for (int i = 0; i < compiled.numNodes; i++)
+    {
+        auto& compiledNode = compiled.nodes[i];
+        
+        evaluate<SampleType>(compiledNode);
+        
+        envelopes.process(compiled.valueStreamIds + compiledNode.firstValueStream, compiledNode.numValueStreams);
+    }
+    
+    for (int i = 0; i < compiled.numValueStreams; i++)
+    {
+        const int streamId = compiled.valueStreamIds[i];
+        displayValues[streamId].store(valueStreams[streamId].hasBeenSet ? envelopes.getValue(streamId) : NAN, std::memory_order_relaxed);
+    }
+}
+
+Data::Node* Data::DataInstance::createNode(juce::XmlElement* elem)
+{
+    switch ((NodeType) elem->getChildByName("type")->getAllSubText().getIntValue())
+    {
+        case NodeType::MainInput:
+            return new Data::MainInputNode(elem);
+        case NodeType::MainOutput:
+            return new Data::MainOutputNode(elem);
+        case NodeType::Gain:
+            return new Data::GainNode(elem);
+        case NodeType::Level:
+            return new Data::LevelNode(elem);
+        case NodeType::Correlation:
+            return new Data::CorrelationNode(elem);
+        case NodeType::Width:
+            return new Data::WidthNode(elem);
+        case NodeType::Loudness:
+            return new Data::LoudnessNode(elem);
+        case NodeType::Maths:
+            return new Data::MathsNode(elem);
+        case NodeType::BandEnergy:
+            return new Data::BandEnergyNode(elem);
+        case NodeType::SpectralFeatures:
+            return new Data::SpectralFeaturesNode(elem);
+        case NodeType::ParameterOutput:
+            return new Data::ParameterOutputNode(elem);
+        case NodeType::ParameterInput:
+            return new Data::ParameterInputNode(elem);
+        case NodeType::MidiOutput:
+            return new Data::MidiOutputNode(elem);
+    }
     
-    if (finalStreamId != -1)
-        evaluate(finalStreamId, ParameterType::Audio);
+    return nullptr;
+}
+
+Data::Node* Data::DataInstance::findNode(int uid, int nodeIdHint)
+{
+    if (nodeIdHint >= 0 && nodeIdHint < NUM_NODES && nodes[nodeIdHint] != nullptr && nodes[nodeIdHint]->uid == uid)
+        return nodes[nodeIdHint];
+    
+    for (int nodeId = 0; nodeId < NUM_NODES; nodeId++)
+    {
+        if (nodes[nodeId] == nullptr) break;
+        
+        if (nodes[nodeId]->uid == uid) return nodes[nodeId];
+    }
+    
+    return nullptr;
+}
+
+void Data::DataInstance::takeRuntimeStateFrom(DataInstance& previous)
+{
+    for (int nodeId = 0; nodeId < NUM_NODES; nodeId++)
+    {
+        auto node = nodes[nodeId];
+        
+        if (node == nullptr) break;
+        
+        const auto type = node->getType();
+        
+        if (type != NodeType::MidiOutput && type != NodeType::Loudness) continue;
+        
+        auto previousNode = previous.findNode(node->uid, nodeId);
+        
+        if (previousNode == nullptr || previousNode->getType() != type) continue; // a new node, which starts from nothing
+        
+        if (type == NodeType::MidiOutput)
+        {
+            auto midiNode = static_cast<MidiOutputNode*>(node);
+            auto previousMidiNode = static_cast<MidiOutputNode*>(previousNode);
+            
+            midiNode->lastSentValue = previousMidiNode->lastSentValue;
+            midiNode->samplesSinceSent = previousMidiNode->samplesSinceSent;
+        }
+        else
+        { // swapped rather than moved, so each node keeps a meter that matches what it was prepared with
+            auto loudnessNode = static_cast<LoudnessNode*>(node);
+            auto previousLoudnessNode = static_cast<LoudnessNode*>(previousNode);
+            
+            std::swap(loudnessNode->meter, previousLoudnessNode->meter);
+            std::swap(loudnessNode->silentSamples, previousLoudnessNode->silentSamples);
+            std::swap(loudnessNode->preparedSampleRate, previousLoudnessNode->preparedSampleRate);
+            std::swap(loudnessNode->preparedSamplesPerBlock, previousLoudnessNode->preparedSamplesPerBlock);
+            std::swap(loudnessNode->preparedChannelWeights, previousLoudnessNode->preparedChannelWeights);
+        }
+    }
+}
+
+void Data::DataInstance::insertNode(int nodeId, Node* node)
+{
+    jassert(nodes[NUM_NODES - 1] == nullptr); // there has to be space for one more
+    
+    for (int iterNodeId = NUM_NODES - 1; iterNodeId > nodeId; iterNodeId--)
+        nodes[iterNodeId] = nodes[iterNodeId - 1];
+    
+    nodes[nodeId] = node;
 }
 
 int Data::DataInstance::getNextNodeId()
@@ -412,49 +1196,118 @@ int Data::DataInstance::getNextNodeId()
     return -1;
 }
 
-int Data::DataInstance::getNextStreamId(ParameterType type)
+int Data::DataInstance::getNextStreamId(ParameterType type)
+{
+    prepareStreams();
+    
+    if (type == ParameterType::Audio) {
+        for (int i = 0; i < NUM_AUDIO_STREAMS; i++) if (audioStreams[i].inputNodeId == -1 || audioStreams[i].outputNodeId == -1) return i;
+    } else if (type == ParameterType::Value) {
+        for (int i = 0; i < NUM_VALUE_STREAMS; i++) if (valueStreams[i].inputNodeId == -1 || valueStreams[i].outputNodeId == -1) return i;
+    }
+    
+    return -1;
+}
+
+
+DataManager::DataManager()
+{
+//    a = new Data::DataInstance;
+//    b = new Data::DataInstance;
+    a.i = 0;
+    a.arena = &arena;
+    a.events = &events;
+    
+    events.onEvent = [this] (const EngineEvent& event) {
+        handleEngineEvent(event);
+    };
+    activeInstance.store(&a, std::memory_order_release);
+    inactiveInstance = nullptr; // see createInactiveInstance()
+    
+    history.reset(new EditHistory());
+    
+    // Add global locked nodes
+    addNode(&a, 0, NodeType::MainInput, {300, 300});
+    addNode(&a, 1, NodeType::MainOutput, {600, 300});
+    
+    getActiveInstance()->prepare();
+}
+
+void DataManager::createInactiveInstance()
+{
+    // nothing but the message thread touches the inactive instance, so it can be made here without the audio thread noticing
+    b.reset(new Data::DataInstance());
+    b->i = 1;
+    b->arena = &arena;
+    b->events = &events;
+    b->hostParameters = a.hostParameters;
+    
+    if (a.numChannels > 0) // prepareToPlay() has been called already
+        b->prepareToPlay(a.sampleRate, a.channelSet, a.samplesPerBlock, a.useDoublePrecision);
+    
+    inactiveInstance = b.get();
+}
+
+DataManager::~DataManager()
+{
+   #if FXGRAPH_SWAP_LATENCY_STATS
+    juce::Logger::writeToLog("FXGraph: " + swapLatency.getSummary());
+   #endif
+}
+
+void DataManager::setHostParameters(HostParameters* hostParameters)
 {
-    prepareStreams();
+    a.hostParameters = hostParameters;
     
-    if (type == ParameterType::Audio) {
-        for (int i = 0; i < NUM_AUDIO_STREAMS; i++) if (audioStreams[i].inputNodeId == -1 || audioStreams[i].outputNodeId == -1) return i;
-    } else if (type == ParameterType::Value) {
-        for (int i = 0; i < NUM_VALUE_STREAMS; i++) if (valueStreams[i].inputNodeId == -1 || valueStreams[i].outputNodeId == -1) return i;
-    }
+    if (b != nullptr) b->hostParameters = hostParameters;
+}
+
+void DataManager::prepareToPlay(double sampleRate, const juce::AudioChannelSet& channelSet, int samplesPerBlock, bool useDoublePrecision)
+{
+    arena.prepare(channelSet.size(), samplesPerBlock, useDoublePrecision);
     
-    return -1;
+    a.prepareToPlay(sampleRate, channelSet, samplesPerBlock, useDoublePrecision);
+    
+    if (b != nullptr) b->prepareToPlay(sampleRate, channelSet, samplesPerBlock, useDoublePrecision);
 }
 
+/** Editing methods */
 
-DataManager::DataManager()
+static int getHostParameterSlot(Data::Node* node)
 {
-//    a = new Data::DataInstance;
-//    b = new Data::DataInstance;
-    a.i = 0;
-    b.i = 1;
-    activeInstance = &a;
-    inactiveInstance = &b;
+    if (node->getType() == NodeType::ParameterOutput) return static_cast<Data::ParameterOutputNode*>(node)->slot;
+    if (node->getType() == NodeType::ParameterInput) return static_cast<Data::ParameterInputNode*>(node)->slot;
     
-    for (auto instance : {activeInstance, inactiveInstance})
-    { // Add global locked nodes for each instance
-        addNode(instance, 0, NodeType::MainInput, {300, 300});
-        addNode(instance, 1, NodeType::MainOutput, {600, 300});
-    }
+    return -1;
 }
 
-DataManager::~DataManager()
+static int getFreeHostParameterSlot(Data::DataInstance* instance, NodeType type) // the first slot that no other node of the type is using
 {
+    const int numSlots = type == NodeType::ParameterOutput ? NUM_OUTPUT_STREAMS : NUM_INPUT_STREAMS;
+    
+    bool slotUsed[juce::jmax(NUM_OUTPUT_STREAMS, NUM_INPUT_STREAMS)] = {};
+    
+    for (int nodeId = 0; nodeId < NUM_NODES; nodeId++)
+    {
+        if (instance->nodes[nodeId] == nullptr || !instance->nodes[nodeId]->isActive) break;
+        
+        if (instance->nodes[nodeId]->getType() == type)
+            slotUsed[getHostParameterSlot(instance->nodes[nodeId])] = true;
+    }
+    
+    int slot = 0;
+    
+    while (slot < numSlots - 1 && slotUsed[slot]) slot++;
     
+    return slot;
 }
 
-/** Editing methods */
-
-void DataManager::addNode(int index, NodeType type, juce::Point<float> position)
+void DataManager::addNode(int index, NodeType type, juce::Point<float> position, int uid)
 {
-    addNode(inactiveInstance, index, type, position);
+    addNode(inactiveInstance, index, type, position, uid);
 }
 
-void DataManager::addNode(Data::DataInstance* instance, int index, NodeType type, juce::Point<float> position)
+void DataManager::addNode(Data::DataInstance* instance, int index, NodeType type, juce::Point<float> position, int uid)
 {
     
     //TODO: change whole thing
@@ -480,12 +1333,38 @@ void DataManager::addNode(Data::DataInstance* instance, int index, NodeType type
         case NodeType::Correlation:
             node = new Data::CorrelationNode();
             break;
+        case NodeType::Width:
+            node = new Data::WidthNode();
+            break;
         case NodeType::Loudness:
             node = new Data::LoudnessNode();
             break;
         case NodeType::Maths:
             node = new Data::MathsNode();
             break;
+        case NodeType::BandEnergy:
+            node = new Data::BandEnergyNode();
+            break;
+        case NodeType::SpectralFeatures:
+            node = new Data::SpectralFeaturesNode();
+            break;
+        case NodeType::ParameterOutput:
+        {
+            auto parameterOutputNode = new Data::ParameterOutputNode();
+            parameterOutputNode->slot = getFreeHostParameterSlot(instance, type);
+            node = parameterOutputNode;
+        }
+            break;
+        case NodeType::MidiOutput:
+            node = new Data::MidiOutputNode();
+            break;
+        case NodeType::ParameterInput:
+        {
+            auto parameterInputNode = new Data::ParameterInputNode();
+            parameterInputNode->slot = getFreeHostParameterSlot(instance, type);
+            node = parameterInputNode;
+        }
+            break;
     }
     
     if (node == nullptr)
@@ -495,9 +1374,12 @@ void DataManager::addNode(Data::DataInstance* instance, int index, NodeType type
     }
     
     node->isActive = true;
-    node->position = position;
 //    node->friendlyName = name;
     
+    if (uid != -1) node->uid = uid; // before it's laid out, so no entry is made under a uid that's then dropped
+    
+    layout.setPosition(node->uid, position);
+    
     delete instance->nodes[index]; // just in case
     instance->nodes[index] = node;
     
@@ -561,17 +1443,7 @@ void DataManager::removeStream(Data::DataInstance* instance, ParameterType type,
     
     if (type == ParameterType::Audio)
     {
-        for (int i = streamId; i < NUM_AUDIO_STREAMS - 1; i++)
-        {
-            
-            for (int channel = 0; channel < instance->audioStreams[i].buffer.getNumChannels(); channel++)
-            {
-                instance->audioStreams[i].buffer.copyFrom(channel, 0, instance->audioStreams[i + 1].buffer, channel, 0, instance->audioStreams[i].buffer.getNumSamples());
-            }
-        }
-        
-        instance->audioStreams[NUM_AUDIO_STREAMS - 1].buffer.clear();
-        
+        // nothing to move: audio streams are rewritten every block, and prepare() points each id at its arena slot
     } else if (type == ParameterType::Value)
     {
         for (int i = streamId; i < NUM_VALUE_STREAMS - 1; i++)
@@ -580,8 +1452,8 @@ void DataManager::removeStream(Data::DataInstance* instance, ParameterType type,
         }
         
         instance->valueStreams[NUM_VALUE_STREAMS - 1].unset();
-        instance->valueStreams[NUM_VALUE_STREAMS - 1].envelope.setMsAttack(35);
-        instance->valueStreams[NUM_VALUE_STREAMS - 1].envelope.setMsRelease(35);
+        instance->valueStreams[NUM_VALUE_STREAMS - 1].setMsAttack(35);
+        instance->valueStreams[NUM_VALUE_STREAMS - 1].setMsRelease(35);
     }
     
     instance->prepareStreams();
@@ -601,22 +1473,22 @@ void DataManager::removeNode(Data::DataInstance *instance, int nodeId)
     {
         if (!instance->nodes[nodeId]->inputParams[paramId].isActive) break;
         
+        if (instance->nodes[nodeId]->inputParams[paramId].isConst) continue;
+        
         int streamId = instance->nodes[nodeId]->inputParams[paramId].streamId;
         if (streamId == -1) continue;
         
-        removeStream(instance->nodes[nodeId]->inputParams[paramId].type, streamId);
+        removeStream(instance, instance->nodes[nodeId]->inputParams[paramId].type, streamId);
     }
     
     for (int paramId = 0; paramId < NUM_PARAMS; paramId++)
     {
         if (!instance->nodes[nodeId]->outputParams[paramId].isActive) break;
         
-        for (int streamIdId = 0; streamIdId < 8; streamIdId++)
+        // removing a stream shuffles the rest down, so keep removing the first until there are none
+        while (instance->nodes[nodeId]->outputParams[paramId].streamIds[0] != -1)
         {
-            int streamId = instance->nodes[nodeId]->outputParams[paramId].streamIds[streamIdId];
-            if (streamId == -1) break;
-            
-            removeStream(instance->nodes[nodeId]->outputParams[paramId].type, streamId);
+            removeStream(instance, instance->nodes[nodeId]->outputParams[paramId].type, instance->nodes[nodeId]->outputParams[paramId].streamIds[0]);
         }
     }
     
@@ -629,11 +1501,270 @@ void DataManager::removeNode(Data::DataInstance *instance, int nodeId)
 //        instance->nodes[iterNodeId]->copyFrom(instance->nodes[iterNodeId + 1]);
     }
     
-    // TODO: clear final node
+    instance->nodes[NUM_NODES - 1] = nullptr;
+    
+    instance->prepare();
+}
+
+int DataManager::connect(ParameterType type, Data::Endpoint producer, Data::Endpoint consumer)
+{
+    auto instance = inactiveInstance;
+    
+    auto& input = instance->nodes[consumer.nodeId]->inputParams[consumer.paramId];
+    auto& output = instance->nodes[producer.nodeId]->outputParams[producer.paramId];
     
+    if (input.type != type || output.type != type) return -1;
     
+    // check the connection can be made before taking anything down, so one that can't leaves the input as it was.
+    // Replacing a stream frees its id, and frees a place on the output if the stream came from it already
+    const bool isReplacing = input.streamId != -1;
     
-    instance->prepare();
+    if (!isReplacing && instance->getNextStreamId(type) == -1) return -1;
+    
+    if (!output.canAddStreamId() && !(isReplacing && output.hasStreamId(input.streamId)))
+    {
+        DBG("failed to add stream - too many streams on output parameter");
+        return -1;
+    }
+    
+    // an input only takes one stream, so replace any that's already there
+    if (isReplacing) removeStream(instance, type, input.streamId);
+    
+    int streamId = instance->getNextStreamId(type);
+    
+    if (streamId == -1 || !output.addStreamId(streamId))
+    {
+        jassertfalse; // ruled out above
+        return -1;
+    }
+    
+    input.isConst = false;
+    input.streamId = streamId;
+    
+    instance->prepareStreams();
+    
+    return streamId;
+}
+
+void DataManager::disconnect(ParameterType type, Data::Endpoint consumer)
+{
+    int streamId = getStreamId(type, consumer);
+    
+    if (streamId != -1) removeStream(inactiveInstance, type, streamId);
+}
+
+int DataManager::getStreamId(ParameterType type, Data::Endpoint consumer)
+{
+    auto node = inactiveInstance->nodes[consumer.nodeId];
+    
+    if (node == nullptr || !node->inputParams[consumer.paramId].isActive) return -1;
+    
+    auto& input = node->inputParams[consumer.paramId];
+    
+    if (input.type != type || input.isConst) return -1;
+    
+    return input.streamId;
+}
+
+Data::Endpoint DataManager::getProducer(ParameterType type, int streamId)
+{
+    return getProducer(inactiveInstance, type, streamId);
+}
+
+Data::Endpoint DataManager::getProducer(Data::DataInstance* instance, ParameterType type, int streamId)
+{
+    Data::Endpoint producer;
+    
+    for (int nodeId = 0; nodeId < NUM_NODES; nodeId++)
+    {
+        if (instance->nodes[nodeId] == nullptr || !instance->nodes[nodeId]->isActive) break;
+        
+        for (int paramId = 0; paramId < NUM_PARAMS; paramId++)
+        {
+            auto& output = instance->nodes[nodeId]->outputParams[paramId];
+            
+            if (!output.isActive) break;
+            if (output.type != type) continue;
+            
+            for (int i = 0; i < 8; i++)
+            {
+                if (output.streamIds[i] == -1) break;
+                
+                if (output.streamIds[i] == streamId)
+                {
+                    producer.nodeId = nodeId;
+                    producer.paramId = paramId;
+                    return producer;
+                }
+            }
+        }
+    }
+    
+    return producer;
+}
+
+Data::Endpoint DataManager::getConsumer(ParameterType type, int streamId)
+{
+    return getConsumer(inactiveInstance, type, streamId);
+}
+
+Data::Endpoint DataManager::getConsumer(Data::DataInstance* instance, ParameterType type, int streamId)
+{
+    Data::Endpoint consumer;
+    
+    for (int nodeId = 0; nodeId < NUM_NODES; nodeId++)
+    {
+        if (instance->nodes[nodeId] == nullptr || !instance->nodes[nodeId]->isActive) break;
+        
+        for (int paramId = 0; paramId < NUM_PARAMS; paramId++)
+        {
+            auto& input = instance->nodes[nodeId]->inputParams[paramId];
+            
+            if (!input.isActive) break;
+            
+            if (input.type == type && !input.isConst && input.streamId == streamId)
+            {
+                consumer.nodeId = nodeId;
+                consumer.paramId = paramId;
+                return consumer;
+            }
+        }
+    }
+    
+    return consumer;
+}
+
+Data::StreamSettings DataManager::getStreamSettings(int valueStreamId)
+{
+    Data::StreamSettings settings;
+    
+    if (valueStreamId == -1) return settings;
+    
+    auto& stream = inactiveInstance->valueStreams[valueStreamId];
+    
+    settings.msAttack = stream.getMsAttack();
+    settings.msRelease = stream.getMsRelease();
+    settings.rampShape = stream.rampShape;
+    
+    return settings;
+}
+
+void DataManager::setStreamSettings(int valueStreamId, const Data::StreamSettings& settings)
+{
+    if (valueStreamId == -1) return;
+    
+    auto& stream = inactiveInstance->valueStreams[valueStreamId];
+    
+    stream.setMsAttack(settings.msAttack);
+    stream.setMsRelease(settings.msRelease);
+    stream.rampShape = settings.rampShape;
+}
+
+float DataManager::getDisplayValue(int valueStreamId)
+{
+    if (valueStreamId == -1) return NAN;
+    
+    return getActiveInstance()->displayValues[valueStreamId].load(std::memory_order_relaxed);
+}
+
+void DataManager::perform(EditCommand* command)
+{
+    apply(command);
+    
+    history->push(command);
+}
+
+void DataManager::apply(EditCommand* command)
+{
+    if (command->isLayoutOnly())
+    { // nothing the audio thread reads changes, so there's no instance to copy or swap
+        command->apply(*this);
+        return;
+    }
+    
+    startEditing();
+    command->apply(*this);
+    finishEditing();
+}
+
+void DataManager::revert(EditCommand* command)
+{
+    if (command->isLayoutOnly())
+    {
+        command->revert(*this);
+        return;
+    }
+    
+    startEditing();
+    command->revert(*this);
+    finishEditing();
+}
+
+void DataManager::undo()
+{
+    auto command = history->stepBack();
+    
+    if (command == nullptr) return;
+    
+    revert(command);
+}
+
+void DataManager::redo()
+{
+    auto command = history->stepForward();
+    
+    if (command == nullptr) return;
+    
+    apply(command);
+}
+
+juce::XmlElement* DataManager::serialise()
+{
+    auto output = getActiveInstance()->serialise();
+    
+    // the instance writes its active nodes in id order
+    int nodeId = 0;
+    
+    for (auto nodeElement : output->getChildWithTagNameIterator("node"))
+        layout.serialise(getActiveInstance()->nodes[nodeId++], nodeElement);
+    
+    return output;
+}
+
+void DataManager::deserialise(juce::XmlElement* element)
+{
+    inactiveInstance->deserialise(element);
+    
+    // the old nodes' entries stay until the loaded graph is realised, and go at the next finishEditing() after that
+    // the instance skips nodes of types it doesn't know, so the elements are matched up by type as well as order
+    int nodeId = 0;
+    
+    for (auto nodeElement : element->getChildWithTagNameIterator("node"))
+    {
+        auto node = inactiveInstance->nodes[nodeId];
+        
+        if (node == nullptr) break;
+        
+        if (nodeElement->getChildElementAllSubText("type", {}).getIntValue() != (int) node->getType()) continue;
+        
+        layout.deserialise(node, nodeElement);
+        nodeId++;
+    }
+}
+
+bool DataManager::canUndo()
+{
+    return history->canStepBack();
+}
+
+bool DataManager::canRedo()
+{
+    return history->canStepForward();
+}
+
+void DataManager::clearHistory()
+{
+    history->clear();
 }
 
 /** Reading methods*/
@@ -645,7 +1776,7 @@ Data::MainOutputNode* DataManager::getOutputNode(Data::DataInstance* instance)
 
 Data::MainOutputNode* DataManager::getOutputNode()
 {
-    return getOutputNode(activeInstance);
+    return getOutputNode(getActiveInstance());
 }
 
 
@@ -656,7 +1787,7 @@ Data::MainInputNode* DataManager::getInputNode(Data::DataInstance* instance)
 
 Data::MainInputNode* DataManager::getInputNode()
 {
-    return getInputNode(activeInstance);
+    return getInputNode(getActiveInstance());
 }
 
 
@@ -669,16 +1800,15 @@ void DataManager::startEditing()
     
     editing = true;
     
-    if (changeQueued) {
-        changeQueued = false; // no need to copy, just edit current inactive instance
-        return;
-    }
+    if (inactiveInstance == nullptr) createInactiveInstance();
+    
+    if (unqueue()) return; // no need to copy, just edit current inactive instance
     
     // copy data from activeInstance to inactiveInstance
     
     for (int i = 0; i < NUM_NODES; i++)
     {
-        if (activeInstance->nodes[i] == nullptr)
+        if (getActiveInstance()->nodes[i] == nullptr)
         {
             delete inactiveInstance->nodes[i]; // maybe needded, maybe not
             inactiveInstance->nodes[i] = nullptr;
@@ -686,73 +1816,191 @@ void DataManager::startEditing()
         }
         
         delete inactiveInstance->nodes[i]; // oopsiess... should have been doing this lol
-        inactiveInstance->nodes[i] = activeInstance->nodes[i]->getCopy();
+        inactiveInstance->nodes[i] = getActiveInstance()->nodes[i]->getCopy();
     }
     
     for (int i = 0; i < NUM_AUDIO_STREAMS; i++)
     {
-        inactiveInstance->audioStreams[i].inputNodeId = activeInstance->audioStreams[i].inputNodeId;
-        inactiveInstance->audioStreams[i].inputParamId = activeInstance->audioStreams[i].inputParamId;
-        inactiveInstance->audioStreams[i].outputNodeId = activeInstance->audioStreams[i].outputNodeId;
-        inactiveInstance->audioStreams[i].outputParamId = activeInstance->audioStreams[i].outputParamId;
+        inactiveInstance->audioStreams[i].inputNodeId = getActiveInstance()->audioStreams[i].inputNodeId;
+        inactiveInstance->audioStreams[i].inputParamId = getActiveInstance()->audioStreams[i].inputParamId;
+        inactiveInstance->audioStreams[i].outputNodeId = getActiveInstance()->audioStreams[i].outputNodeId;
+        inactiveInstance->audioStreams[i].outputParamId = getActiveInstance()->audioStreams[i].outputParamId;
         
-        inactiveInstance->audioStreams[i].buffer.clear();
+        // the buffers aren't cleared: they share their memory with the active instance, which may be processing
     }
     
     for (int i = 0; i < NUM_VALUE_STREAMS; i++)
     {
-        inactiveInstance->valueStreams[i].inputNodeId = activeInstance->valueStreams[i].inputNodeId;
-        inactiveInstance->valueStreams[i].inputParamId = activeInstance->valueStreams[i].inputParamId;
-        inactiveInstance->valueStreams[i].outputNodeId = activeInstance->valueStreams[i].outputNodeId;
-        inactiveInstance->valueStreams[i].outputParamId = activeInstance->valueStreams[i].outputParamId;
+        inactiveInstance->valueStreams[i].inputNodeId = getActiveInstance()->valueStreams[i].inputNodeId;
+        inactiveInstance->valueStreams[i].inputParamId = getActiveInstance()->valueStreams[i].inputParamId;
+        inactiveInstance->valueStreams[i].outputNodeId = getActiveInstance()->valueStreams[i].outputNodeId;
+        inactiveInstance->valueStreams[i].outputParamId = getActiveInstance()->valueStreams[i].outputParamId;
+        inactiveInstance->valueStreams[i].rampShape = getActiveInstance()->valueStreams[i].rampShape;
         
         inactiveInstance->valueStreams[i].unset();
-        
-        inactiveInstance->valueStreams[i].envelope = Envelope(activeInstance->valueStreams[i].envelope);
     }
     
+    inactiveInstance->envelopes.copySettingsFrom(getActiveInstance()->envelopes);
+    
 }
 
 void DataManager::finishEditing()
 {
     editing = false;
     
-    changeQueued = true;
+    pruneLayout();
+    
+    inactiveInstance->prepare(); // do any allocation here on the message thread rather than in realise()
+    
+   #if FXGRAPH_SWAP_LATENCY_STATS
+    inactiveInstance->queuedTicks = juce::Time::getHighResolutionTicks();
+   #endif
+    
+    swapState = queued;
+    
+    if (processing) return; // the audio thread will swap it in at the start of its next block
+    
+    int expected = queued;
+    
+    if (!swapState.compare_exchange_strong(expected, swapping)) return;
+    
+    if (processing)
+    { // a block started in the meantime and is waiting on this; hand the swap over to it rather than changing the instance under it
+        swapState = queued;
+        return;
+    }
+    
+    swapInstances();
+    
+    events.post({EngineEvent::realised});
+}
+
+void DataManager::pruneLayout()
+{
+    // only nodes in neither instance: the active one's are still shown, and the inactive one's will be once it's realised
+    juce::Array<int> uids;
+    
+    for (auto instance : {getActiveInstance(), inactiveInstance})
+        for (int nodeId = 0; nodeId < NUM_NODES && instance->nodes[nodeId] != nullptr; nodeId++)
+            uids.add(instance->nodes[nodeId]->uid);
+    
+    layout.retain(uids);
+}
+
+bool DataManager::unqueue()
+{
+    int expected = queued;
     
-    if (!isProcessing()) realise();
+    while (!swapState.compare_exchange_weak(expected, idle))
+    {
+        if (expected == idle) return false; // already swapped in, so the inactive instance is now the old one
+        
+        expected = queued; // the audio thread is in the middle of swapping, which only takes a moment
+    }
+    
+    return true;
 }
 
 void DataManager::realise()
 {
-    if (!changeQueued) return;
+    for (;;)
+    {
+        int expected = queued;
+        
+        if (swapState.compare_exchange_weak(expected, swapping)) break;
+        
+        if (expected == idle) return;
+        
+        // the message thread is swapping, or about to hand the swap over, which only takes a moment
+    }
+    
+    swapInstances();
+    
+    events.push({EngineEvent::realised});
+}
+
+void DataManager::finishProcessing()
+{
+   #if FXGRAPH_SWAP_LATENCY_STATS
+    if (getActiveInstance() != lastProcessedInstance)
+    { // this is the first block anyone can hear with the new instance
+        if (lastProcessedInstance != nullptr && getActiveInstance()->queuedTicks != 0)
+            swapLatency.add(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - getActiveInstance()->queuedTicks) * 1000.0);
+        
+        lastProcessedInstance = getActiveInstance();
+    }
+   #endif
     
-    changeQueued = false;
+    const int probeStreamId = probe.getStreamId();
     
-    if (activeInstance->i == a.i)
+    if (probeStreamId != -1)
+        writeProbe(probeStreamId);
+    
+    if (getActiveInstance()->numSamples > 0 && getActiveInstance()->sampleRate > 0)
     {
-        activeInstance = &b;
-        inactiveInstance = &a;
-    } else {
-        activeInstance = &a;
-        inactiveInstance = &b;
+        const double elapsedSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - processingStartTicks);
+        const double blockSeconds = getActiveInstance()->numSamples / getActiveInstance()->sampleRate;
+        
+        if (elapsedSeconds > blockSeconds)
+        {
+            EngineEvent event {EngineEvent::overload};
+            event.load = (float) (elapsedSeconds / blockSeconds);
+            
+            events.push(event);
+        }
     }
     
-//    for (int listenerIndex = 0; listenerIndex < oneTimeRealisationListeners.size(); listenerIndex++)
-//    {
-//        oneTimeRealisationListeners[listenerIndex]->operator()();
-//        
-////        (*listener)();
-//        oneTimeRealisationListeners.remove(listenerIndex);
-//    }
+    processing = false;
+}
+
+void DataManager::writeProbe(int audioStreamId)
+{
+    if (audioStreamId < 0 || audioStreamId >= NUM_AUDIO_STREAMS || getActiveInstance()->numSamples <= 0) return;
+    
+    auto& stream = getActiveInstance()->audioStreams[audioStreamId];
+    
+    // a stream that isn't connected at both ends has no buffer, which reads as silence
+    const bool isSilent = stream.isSilent || !getActiveInstance()->isStreamInUse(ParameterType::Audio, audioStreamId);
     
-    if (oneTimeListenerFlag){
-        MessageManager::callAsync(oneTimeRealisationListener);
-        oneTimeListenerFlag = false;
+    if (getActiveInstance()->useDoublePrecision)
+        probe.write(stream.doubleBuffer, getActiveInstance()->numSamples, isSilent);
+    else
+        probe.write(stream.buffer, getActiveInstance()->numSamples, isSilent);
+}
+
+void DataManager::handleEngineEvent(const EngineEvent& event)
+{
+    switch (event.type)
+    {
+        case EngineEvent::realised:
+            if (oneTimeListenerFlag) {
+                oneTimeListenerFlag = false;
+                oneTimeRealisationListener();
+            }
+            
+            realisationListener();
+            break;
+        case EngineEvent::overload:
+            DBG("FXGraph: block took " << juce::String(event.load * 100.0f, 0) << "% of its length to process");
+            break;
+        case EngineEvent::error:
+            DBG("FXGraph: engine error " << (int) event.error << " from node " << event.nodeId);
+            break;
     }
+}
+
+void DataManager::swapInstances()
+{
+    // the listeners are told through the event queue by whoever called this, so nothing here allocates or locks
+    
+    auto previous = getActiveInstance();
+    auto next = previous->i == a.i ? b.get() : &a;
+    
+    next->takeRuntimeStateFrom(*previous);
     
-    MessageManager::callAsync(realisationListener);
+    inactiveInstance = previous;
+    activeInstance.store(next, std::memory_order_release);
     
-//    oneTimeRealisationListener();
-//    realisationListener();
+    swapState = idle;
 }
 
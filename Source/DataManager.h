@@ -11,9 +11,21 @@
 #pragma once
 #include "JuceHeader.h"
 #include "Envelope.h"
+#include "SpectrumCache.h"
+#include "SharedResources.h"
+#include "AudioStreamArena.h"
+#include "SwapLatencyStats.h"
+#include "EngineEvents.h"
+#include "AudioProbe.h"
+#include "LayoutModel.h"
 #include "LUFSMeter/Ebu128LoudnessMeter.h"
 #include "exprtk/exprtk.hpp"
 
+// logs how long edits take to be heard when the DataManager is destroyed, to check the engine under heavy editing
+#ifndef FXGRAPH_SWAP_LATENCY_STATS
+ #define FXGRAPH_SWAP_LATENCY_STATS 0
+#endif
+
 enum InputOrOutput
 {
     Input,
@@ -26,6 +38,13 @@ enum ParameterType
     Value
 };
 
+enum RampShape // how a value stream is interpolated across a block when read at audio rate
+{
+    RampLinear = 0,
+    RampDecibelLinear = 1,
+    RampOnePole = 2
+};
+
 enum NodeType
 {
     MainInput = 0,
@@ -35,15 +54,26 @@ enum NodeType
     Correlation = 4,
     Loudness = 5,
     Maths = 6,
+    BandEnergy = 7,
+    SpectralFeatures = 8,
+    ParameterOutput = 9,
+    ParameterInput = 10,
+    MidiOutput = 11,
+    Width = 12,
 };
 
-const NodeType NodeTypes[] = { MainInput, MainOutput, Gain, Level, Correlation, Loudness, Maths};
+const NodeType NodeTypes[] = { MainInput, MainOutput, Gain, Level, Correlation, Loudness, Maths, BandEnergy, SpectralFeatures, ParameterOutput, ParameterInput, MidiOutput, Width};
 
 const int NUM_NODES = 64;
 const int NUM_AUDIO_STREAMS = 128;
 const int NUM_VALUE_STREAMS = 128;
 const int NUM_PARAMS = 16;
-const int NUM_OUTPUT_STREAMS = 8;
+const int NUM_OUTPUT_STREAMS = 8; // host parameters published by parameter output nodes
+const int NUM_INPUT_STREAMS = 8; // host parameters read by parameter input nodes
+
+class HostParameters;
+class EditHistory;
+struct EditCommand;
 
 namespace Data
 {
@@ -77,7 +107,7 @@ struct InputParameter : Parameter {
     float constValue;
     int streamId = -1;
     
-    void copyFrom(InputParameter other)
+    void copyFrom(const InputParameter& other)
     {
         isActive = other.isActive;
         type = other.type;
@@ -162,7 +192,7 @@ struct InputParameter : Parameter {
 struct OutputParameter : Parameter {
     int streamIds[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
     
-    void copyFrom(OutputParameter other)
+    void copyFrom(const OutputParameter& other)
     {
         isActive = other.isActive;
         type = other.type;
@@ -175,6 +205,22 @@ struct OutputParameter : Parameter {
         }
     }
     
+    bool canAddStreamId()
+    {
+        for (int i = 0; i < 8; i++)
+            if (streamIds[i] == -1) return true;
+        
+        return false;
+    }
+    
+    bool hasStreamId(int streamId)
+    {
+        for (int i = 0; i < 8; i++)
+            if (streamIds[i] == streamId) return true;
+        
+        return false;
+    }
+    
     bool addStreamId(int streamId) // returns success
     {
         for (int i = 0; i < 8; i++)
@@ -305,13 +351,6 @@ public:
         auto friendlyNameElement = elem->getChildByName("friendlyName");
         friendlyName = friendlyNameElement->getAllSubText();
         
-        auto positionElement = elem->getChildByName("position");
-        auto xElement = positionElement->getChildByName("x");
-        auto yElement = positionElement->getChildByName("y");
-        
-        position.setX(xElement->getAllSubText().getFloatValue());
-        position.setY(yElement->getAllSubText().getFloatValue());
-        
         for (auto inputParamElement : elem->getChildWithTagNameIterator("inputParam"))
         {
             inputParams[inputParamElement->getChildByName("paramId")->getAllSubText().getIntValue()].deserialise(inputParamElement);
@@ -327,13 +366,21 @@ public:
     bool isActive = false; // TODO: this doesn't seem necessary now that inactive nodes are nullptr?
     InputParameter inputParams[NUM_PARAMS];
     OutputParameter outputParams[NUM_PARAMS];
-    juce::String friendlyName;
-    juce::Point<float> position;
+    juce::String friendlyName; // the type's name; where the node sits and what it's labelled on the canvas are in the DataManager's LayoutModel
     
     bool isGlobalLockedNode = false;
     bool hasInputSide = true;
     bool hasOutputSide = true;
     
+    // which node this is, unlike its id, which changes as nodes before it are removed. Copies keep it, so the same node has the same uid in both instances
+    int uid = getNextUid();
+    
+    static int getNextUid() // any thread, since hosts can construct and restore instances in parallel
+    {
+        static std::atomic<int> nextUid {0};
+        return nextUid.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    
     juce::XmlElement* serialise()
     {
         auto output = new juce::XmlElement("node");
@@ -353,22 +400,11 @@ public:
         auto friendlyNameElement = new juce::XmlElement("friendlyName");
         friendlyNameElement->addTextElement(friendlyName);
         
-        auto positionElement = new juce::XmlElement("position");
-        
-        auto positionXElement = new juce::XmlElement("x");
-        auto positionYElement = new juce::XmlElement("y");
-        positionXElement->addTextElement(juce::String(position.getX()));
-        positionYElement->addTextElement(juce::String(position.getY()));
-        
-        positionElement->addChildElement(positionXElement);
-        positionElement->addChildElement(positionYElement);
-        
         output->addChildElement(typeElement);
         output->addChildElement(isGlobalLockedNodeElement);
         output->addChildElement(hasInputSideElement);
         output->addChildElement(hasOutputSideElement);
         output->addChildElement(friendlyNameElement);
-        output->addChildElement(positionElement);
         
         for (int i = 0; i < NUM_PARAMS; i++)
         {
@@ -467,7 +503,21 @@ public:
         outputParams[0].type = ParameterType::Audio;
     };
     
-    juce::AudioBuffer<float>* mainInput;
+    // not the buffers, which the audio thread may be setting on the node being copied; it sets them on the active instance's node every block, after any swap
+    MainInputNode(const MainInputNode& other) : Node(other) { };
+    
+    juce::AudioBuffer<float>* mainInput = nullptr;
+    juce::AudioBuffer<double>* mainInputDouble = nullptr; // one or the other, depending on the processing precision
+    
+    template <typename SampleType>
+    juce::AudioBuffer<SampleType>* getMainInput()
+    {
+        if constexpr (std::is_same<SampleType, double>::value) return mainInputDouble;
+        else return mainInput;
+    }
+    
+    void setMainInput(juce::AudioBuffer<float>* buffer) {mainInput = buffer; mainInputDouble = nullptr;}
+    void setMainInput(juce::AudioBuffer<double>* buffer) {mainInput = nullptr; mainInputDouble = buffer;}
     
     NodeType getType() override {return NodeType::MainInput;}
     Node* getCopy() override {return new MainInputNode(*this);}
@@ -569,23 +619,74 @@ public:
         inputParams[0].friendlyName = "In";
         inputParams[0].type = ParameterType::Audio;
         
+        addChannelPairParams(*this, elem);
+        
         outputParams[0].isActive = true;
         outputParams[0].friendlyName = "Correlation";
         outputParams[0].type = ParameterType::Value;
     };
     
+    // the two channels of the input to compare, by index; graphs saved before these existed read channels 0 and 1
+    static void addChannelPairParams(Node& node, juce::XmlElement* elem)
+    {
+        node.inputParams[1].isActive = true;
+        node.inputParams[1].friendlyName = "Channel A";
+        node.inputParams[1].type = ParameterType::Value;
+        
+        node.inputParams[2].isActive = true;
+        node.inputParams[2].friendlyName = "Channel B";
+        node.inputParams[2].type = ParameterType::Value;
+        
+        if (elem == nullptr)
+        {
+            node.inputParams[1].isConst = true;
+            node.inputParams[1].constValue = 0.0f;
+            
+            node.inputParams[2].isConst = true;
+            node.inputParams[2].constValue = 1.0f;
+        }
+    }
+    
     NodeType getType() override {return NodeType::Correlation;}
     Node* getCopy() override {return new CorrelationNode(*this);}
     
     static const Node::Defaults defaults;
 };
 
+class WidthNode : public Node
+{
+public:
+    WidthNode() : WidthNode(nullptr) { };
+    
+    WidthNode(juce::XmlElement* elem) : Node(elem) {
+        hasInputSide = defaults.hasInputSide;
+        hasOutputSide = defaults.hasOutputSide;
+        friendlyName = defaults.name;
+        
+        inputParams[0].isActive = true;
+        inputParams[0].friendlyName = "In";
+        inputParams[0].type = ParameterType::Audio;
+        
+        CorrelationNode::addChannelPairParams(*this, elem);
+        
+        // side energy over total energy: 0 for mono, 0.5 for unrelated channels, 1 for channels out of phase
+        outputParams[0].isActive = true;
+        outputParams[0].friendlyName = "Width";
+        outputParams[0].type = ParameterType::Value;
+    };
+    
+    NodeType getType() override {return NodeType::Width;}
+    Node* getCopy() override {return new WidthNode(*this);}
+    
+    static const Node::Defaults defaults;
+};
+
 class LoudnessNode : public Node
 {
 public:
     LoudnessNode() : LoudnessNode(nullptr) { };
     
-    LoudnessNode(const LoudnessNode& ln) : Node(ln), meter(nullptr) {
+    LoudnessNode(const LoudnessNode& ln) : Node(ln), meter(nullptr) { // nothing the audio thread writes is read from ln
         meter.reset(new Ebu128LoudnessMeter());
     };
     
@@ -623,6 +724,27 @@ public:
     
     std::unique_ptr<Ebu128LoudnessMeter> meter;
     
+    // the longest window the meter reads (short term); once it has only seen silence for this long, more silence can't change any reading
+    static constexpr double settleSeconds = 3.0;
+    int silentSamples = 0; // like the meter, handed over at the swap by DataInstance::takeRuntimeStateFrom() rather than copied
+    
+    void prepareMeter(double sampleRate, int samplesPerBlock, const std::vector<double>& channelWeights) // only if any of them have changed
+    {
+        if (sampleRate == preparedSampleRate && samplesPerBlock == preparedSamplesPerBlock && channelWeights == preparedChannelWeights) return;
+        if (channelWeights.empty()) return;
+        
+        meter->prepareToPlay(sampleRate, (int) channelWeights.size(), samplesPerBlock, 10);
+        meter->setChannelWeighting(channelWeights);
+        
+        preparedSampleRate = sampleRate;
+        preparedSamplesPerBlock = samplesPerBlock;
+        preparedChannelWeights = channelWeights;
+    }
+    
+    double preparedSampleRate = 0;
+    int preparedSamplesPerBlock = 0;
+    std::vector<double> preparedChannelWeights;
+    
     static const Node::Defaults defaults;
 };
 
@@ -686,12 +808,12 @@ public:
             symbol_table.add_variable(inputParams[i].name.toStdString(), inputs[i]);
         }
         
-        parser.compile(expression_string, expression);
+        shared->compileExpression(expression_string, expression);
     }
     
     void updateExpressionString()
     {
-        parser.compile(expression_string, expression);
+        shared->compileExpression(expression_string, expression);
     }
     
     void updateExpressionString(juce::String new_expr)
@@ -717,31 +839,328 @@ public:
     bool canAddInputParam() override {return true;}
     
     exprtk::symbol_table<float> symbol_table;
-    exprtk::parser<float> parser;
     exprtk::expression<float> expression;
     
+    juce::SharedResourcePointer<SharedResources> shared; // the parser, which is large and only needed while compiling
+    
     float inputs[NUM_PARAMS];
     std::string expression_string;
     
     static const Node::Defaults defaults;
 };
 
+class BandEnergyNode : public Node
+{
+public:
+    BandEnergyNode() : BandEnergyNode(nullptr) { };
+    
+    BandEnergyNode(juce::XmlElement* elem) : Node(elem) {
+        hasInputSide = defaults.hasInputSide;
+        hasOutputSide = defaults.hasOutputSide;
+        friendlyName = defaults.name;
+        
+        inputParams[0].isActive = true;
+        inputParams[0].friendlyName = "In";
+        inputParams[0].type = ParameterType::Audio;
+        
+        inputParams[1].isActive = true;
+        inputParams[1].friendlyName = "Low Hz";
+        inputParams[1].type = ParameterType::Value;
+        
+        inputParams[2].isActive = true;
+        inputParams[2].friendlyName = "High Hz";
+        inputParams[2].type = ParameterType::Value;
+        
+        if (elem == nullptr)
+        { // start off with a sensible band rather than two unconnected inputs
+            inputParams[1].isConst = true;
+            inputParams[1].constValue = 200.0f;
+            
+            inputParams[2].isConst = true;
+            inputParams[2].constValue = 2000.0f;
+        }
+        
+        outputParams[0].isActive = true;
+        outputParams[0].friendlyName = "dbFS";
+        outputParams[0].type = ParameterType::Value;
+    };
+    
+    NodeType getType() override {return NodeType::BandEnergy;}
+    Node* getCopy() override {return new BandEnergyNode(*this);}
+    
+    static const Node::Defaults defaults;
+};
+
+class SpectralFeaturesNode : public Node
+{
+public:
+    SpectralFeaturesNode() : SpectralFeaturesNode(nullptr) { };
+    
+    SpectralFeaturesNode(juce::XmlElement* elem) : Node(elem) {
+        hasInputSide = defaults.hasInputSide;
+        hasOutputSide = defaults.hasOutputSide;
+        friendlyName = defaults.name;
+        
+        inputParams[0].isActive = true;
+        inputParams[0].friendlyName = "In";
+        inputParams[0].type = ParameterType::Audio;
+        
+        outputParams[0].isActive = true;
+        outputParams[0].friendlyName = "Centroid";
+        outputParams[0].type = ParameterType::Value;
+        
+        outputParams[1].isActive = true;
+        outputParams[1].friendlyName = "Flux";
+        outputParams[1].type = ParameterType::Value;
+        
+        outputParams[2].isActive = true;
+        outputParams[2].friendlyName = "Rolloff";
+        outputParams[2].type = ParameterType::Value;
+        
+        outputParams[3].isActive = true;
+        outputParams[3].friendlyName = "Flatness";
+        outputParams[3].type = ParameterType::Value;
+    };
+    
+    NodeType getType() override {return NodeType::SpectralFeatures;}
+    Node* getCopy() override {return new SpectralFeaturesNode(*this);}
+    
+    static const Node::Defaults defaults;
+};
+
+class ParameterOutputNode : public Node
+{
+public:
+    ParameterOutputNode() : ParameterOutputNode(nullptr) { };
+    
+    ParameterOutputNode(juce::XmlElement* elem) : Node(elem) {
+        hasInputSide = defaults.hasInputSide;
+        hasOutputSide = defaults.hasOutputSide;
+        friendlyName = defaults.name;
+        
+        inputParams[0].isActive = true;
+        inputParams[0].friendlyName = "Value";
+        inputParams[0].type = ParameterType::Value;
+        
+        inputParams[1].isActive = true;
+        inputParams[1].friendlyName = "Min";
+        inputParams[1].type = ParameterType::Value;
+        
+        inputParams[2].isActive = true;
+        inputParams[2].friendlyName = "Max";
+        inputParams[2].type = ParameterType::Value;
+        
+        if (elem == nullptr)
+        { // values are mapped from min and max onto the host's 0 to 1
+            inputParams[1].isConst = true;
+            inputParams[1].constValue = 0.0f;
+            
+            inputParams[2].isConst = true;
+            inputParams[2].constValue = 1.0f;
+        } else if (elem->getChildByName("slot") != nullptr)
+        {
+            slot = juce::jlimit(0, NUM_OUTPUT_STREAMS - 1, elem->getChildByName("slot")->getAllSubText().getIntValue());
+        }
+    };
+    
+    void additionalSerialisation(juce::XmlElement* elem) override {
+        auto slotElement = new juce::XmlElement("slot");
+        slotElement->addTextElement(juce::String(slot));
+        
+        elem->addChildElement(slotElement);
+    }
+    
+    NodeType getType() override {return NodeType::ParameterOutput;}
+    Node* getCopy() override {return new ParameterOutputNode(*this);}
+    
+    int slot = 0; // which of the host parameters this publishes to
+    
+    static const Node::Defaults defaults;
+};
+
+class ParameterInputNode : public Node
+{
+public:
+    ParameterInputNode() : ParameterInputNode(nullptr) { };
+    
+    ParameterInputNode(juce::XmlElement* elem) : Node(elem) {
+        hasInputSide = defaults.hasInputSide;
+        hasOutputSide = defaults.hasOutputSide;
+        friendlyName = defaults.name;
+        
+        outputParams[0].isActive = true;
+        outputParams[0].friendlyName = "Value";
+        outputParams[0].type = ParameterType::Value;
+        
+        if (elem != nullptr && elem->getChildByName("slot") != nullptr)
+            slot = juce::jlimit(0, NUM_INPUT_STREAMS - 1, elem->getChildByName("slot")->getAllSubText().getIntValue());
+    };
+    
+    void additionalSerialisation(juce::XmlElement* elem) override {
+        auto slotElement = new juce::XmlElement("slot");
+        slotElement->addTextElement(juce::String(slot));
+        
+        elem->addChildElement(slotElement);
+    }
+    
+    NodeType getType() override {return NodeType::ParameterInput;}
+    Node* getCopy() override {return new ParameterInputNode(*this);}
+    
+    int slot = 0; // which of the host parameters this reads from
+    
+    static const Node::Defaults defaults;
+};
+
+class MidiOutputNode : public Node
+{
+public:
+    enum MessageType
+    {
+        ControlChange = 0,
+        ControlChange14Bit = 1,
+        PitchBend = 2
+    };
+    
+    MidiOutputNode() : MidiOutputNode(nullptr) { };
+    
+    // only the settings; the audio thread may be writing the thinning state of the node being copied, which is handed over at the swap instead
+    MidiOutputNode(const MidiOutputNode& other) : Node(other), messageType(other.messageType), channel(other.channel), controller(other.controller), thresholdSteps(other.thresholdSteps), minIntervalMs(other.minIntervalMs) { };
+    
+    MidiOutputNode(juce::XmlElement* elem) : Node(elem) {
+        hasInputSide = defaults.hasInputSide;
+        hasOutputSide = defaults.hasOutputSide;
+        friendlyName = defaults.name;
+        
+        inputParams[0].isActive = true;
+        inputParams[0].friendlyName = "Value";
+        inputParams[0].type = ParameterType::Value;
+        
+        inputParams[1].isActive = true;
+        inputParams[1].friendlyName = "Min";
+        inputParams[1].type = ParameterType::Value;
+        
+        inputParams[2].isActive = true;
+        inputParams[2].friendlyName = "Max";
+        inputParams[2].type = ParameterType::Value;
+        
+        if (elem == nullptr)
+        { // values are mapped from min and max onto the whole range of the message
+            inputParams[1].isConst = true;
+            inputParams[1].constValue = 0.0f;
+            
+            inputParams[2].isConst = true;
+            inputParams[2].constValue = 1.0f;
+            
+            return;
+        }
+        
+        auto midiElement = elem->getChildByName("midi");
+        
+        if (midiElement == nullptr) return;
+        
+        messageType = (MessageType) juce::jlimit(0, 2, midiElement->getIntAttribute("type", messageType));
+        channel = juce::jlimit(1, 16, midiElement->getIntAttribute("channel", channel));
+        controller = juce::jlimit(0, getMaxController(), midiElement->getIntAttribute("controller", controller));
+        thresholdSteps = juce::jmax(1, midiElement->getIntAttribute("threshold", thresholdSteps));
+        minIntervalMs = (float) juce::jmax(0.0, midiElement->getDoubleAttribute("minInterval", minIntervalMs));
+    };
+    
+    void additionalSerialisation(juce::XmlElement* elem) override {
+        auto midiElement = new juce::XmlElement("midi");
+        
+        midiElement->setAttribute("type", messageType);
+        midiElement->setAttribute("channel", channel);
+        midiElement->setAttribute("controller", controller);
+        midiElement->setAttribute("threshold", thresholdSteps);
+        midiElement->setAttribute("minInterval", minIntervalMs);
+        
+        elem->addChildElement(midiElement);
+    }
+    
+    int getMaxValue() {return messageType == MessageType::ControlChange ? 127 : 16383;}
+    int getMaxController() {return messageType == MessageType::ControlChange14Bit ? 31 : 127;} // 14 bit also sends on controller + 32
+    
+    void addMessages(juce::MidiBuffer& buffer, int value, int samplePosition)
+    {
+        switch (messageType)
+        {
+            case MessageType::ControlChange:
+                buffer.addEvent(juce::MidiMessage::controllerEvent(channel, controller, value), samplePosition);
+                break;
+            case MessageType::ControlChange14Bit: // most significant byte first, then the least significant on controller + 32
+            {
+                const int msbController = juce::jmin(controller, getMaxController()); // anything higher would send an invalid data byte
+                
+                buffer.addEvent(juce::MidiMessage::controllerEvent(channel, msbController, value >> 7), samplePosition);
+                buffer.addEvent(juce::MidiMessage::controllerEvent(channel, msbController + 32, value & 127), samplePosition);
+            }
+                break;
+            case MessageType::PitchBend:
+                buffer.addEvent(juce::MidiMessage::pitchWheel(channel, value), samplePosition);
+                break;
+        }
+    }
+    
+    NodeType getType() override {return NodeType::MidiOutput;}
+    Node* getCopy() override {return new MidiOutputNode(*this);}
+    
+    MessageType messageType = MessageType::ControlChange;
+    int channel = 1;
+    int controller = 1; // for 14 bit, the most significant byte's controller (0 to 31)
+    int thresholdSteps = 1; // smallest change worth sending, in steps of the message's resolution
+    float minIntervalMs = 5; // between messages; changes smaller than the threshold are still sent once they've held for settleIntervals of these
+    
+    static constexpr int settleIntervals = 8;
+    
+    // carried over between blocks, and across edits by DataInstance::takeRuntimeStateFrom()
+    int lastSentValue = -1;
+    int samplesSinceSent = 0;
+    
+    static const Node::Defaults defaults;
+};
+
 struct AudioStream : Stream {
     juce::AudioBuffer<float> buffer;
+    juce::AudioBuffer<double> doubleBuffer; // used instead of buffer while processing in double precision
+    
+    template <typename SampleType>
+    juce::AudioBuffer<SampleType>& getBuffer()
+    {
+        if constexpr (std::is_same<SampleType, double>::value) return doubleBuffer;
+        else return buffer;
+    }
+    
+    std::unique_ptr<SpectrumCache> spectrum; // only allocated while a spectral node reads this stream
+    int spectrumBlockIndex = -1; // the block the spectrum was last pushed in
+    
+    bool isSilent = false; // the producer wrote digital silence this block, and the buffer is all zeros
     
     AudioStream() : Stream(ParameterType::Audio) {};
     
 };
 
+typedef EnvelopeBank<NUM_VALUE_STREAMS> ValueStreamEnvelopes;
+
 struct ValueStream : Stream {
-    float value;
-    float prevValue;
-    
-    Envelope envelope;
+    ValueStreamEnvelopes* envelopes = nullptr; // owned by the DataInstance, indexed by selfId
     
     bool hasBeenSet = false;
     
-    void setValue(float v)
+    float getValue() {return envelopes->getValue(selfId);}
+    float getPrevValue() {return envelopes->getPrevValue(selfId);}
+    float getTarget() {return envelopes->getTarget(selfId);}
+    
+    RampShape rampShape = RampShape::RampLinear;
+    
+    // only allocated while an audio-rate node reads this stream. Channel 0 is in the stream's own units and channel 1 is converted
+    // from decibels to linear gain, each generated at most once per block, so a gain and a MIDI output can read the same stream
+    juce::AudioBuffer<float> ramp;
+    int rampBlockIndex[2] = {-2, -2}; // the block each form was last generated in
+    float rampEnd[2] = {}; // the last sample of each, which the one pole ramp carries on from, however long last block was
+    
+    void resetRamps() {rampBlockIndex[0] = rampBlockIndex[1] = -2;}
+    
+    void setValue(float v) // the envelope is run once the producing node has set all its outputs
     {
         if (isnan(v))
         {
@@ -750,11 +1169,10 @@ struct ValueStream : Stream {
         }
         if (hasBeenSet)
         {
-            prevValue = value;
-            envelope.run(v, value);
+            envelopes->setTarget(selfId, v);
         } else {
             hasBeenSet = true;
-            value = prevValue = v;
+            envelopes->snapTo(selfId, v);
         }
     }
     
@@ -765,17 +1183,20 @@ struct ValueStream : Stream {
     
     void copyFrom(ValueStream* v)
     {
-        value = v->value;
-        prevValue = v->prevValue;
         hasBeenSet = v->hasBeenSet;
+        rampShape = v->rampShape;
+        resetRamps();
         
-        envelope.setMsAttack(v->envelope.getMsAttack());
-        envelope.setMsRelease(v->envelope.getMsRelease());
+        envelopes->copy(v->selfId, selfId);
     }
     
-    ValueStream() : Stream(ParameterType::Value) {
-        envelope = Envelope(35, 35, 44100.0);
-    };
+    void setMsAttack(float ms) {envelopes->setMsAttack(selfId, ms);}
+    float getMsAttack() {return envelopes->getMsAttack(selfId);}
+    
+    void setMsRelease(float ms) {envelopes->setMsRelease(selfId, ms);}
+    float getMsRelease() {return envelopes->getMsRelease(selfId);}
+    
+    ValueStream() : Stream(ParameterType::Value) {};
     
     juce::XmlElement* serialise(int i)
     {
@@ -787,15 +1208,19 @@ struct ValueStream : Stream {
         auto envelopeElement = new juce::XmlElement("envelope");
         
         auto attackElement = new juce::XmlElement("attack");
-        attackElement->addTextElement(juce::String(envelope.getMsAttack()));
+        attackElement->addTextElement(juce::String(getMsAttack()));
         
         auto releaseElement = new juce::XmlElement("release");
-        releaseElement->addTextElement(juce::String(envelope.getMsRelease()));
+        releaseElement->addTextElement(juce::String(getMsRelease()));
         
         envelopeElement->addChildElement(attackElement);
         envelopeElement->addChildElement(releaseElement);
         
+        auto rampElement = new juce::XmlElement("ramp");
+        rampElement->addTextElement(juce::String(rampShape));
+        
         output->addChildElement(envelopeElement);
+        output->addChildElement(rampElement);
         output->addChildElement(streamIdElement);
         
         return output;
@@ -805,17 +1230,86 @@ struct ValueStream : Stream {
     {
         auto envelopeElement = elem->getChildByName("envelope");
         
-        envelope.setMsAttack(envelopeElement->getChildByName("attack")->getAllSubText().getFloatValue());
-        envelope.setMsRelease(envelopeElement->getChildByName("release")->getAllSubText().getFloatValue());
+        setMsAttack(envelopeElement->getChildByName("attack")->getAllSubText().getFloatValue());
+        setMsRelease(envelopeElement->getChildByName("release")->getAllSubText().getFloatValue());
+        
+        auto rampElement = elem->getChildByName("ramp");
+        
+        if (rampElement != nullptr) // not saved by older versions
+            rampShape = (RampShape) juce::jlimit(0, 2, rampElement->getAllSubText().getIntValue());
     }
 };
 
+struct Endpoint // one side of a stream: a parameter on a node
+{
+    int nodeId = -1;
+    int paramId = -1;
+};
+
+struct StreamSettings // what a value stream keeps besides its connection
+{
+    float msAttack = 35;
+    float msRelease = 35;
+    RampShape rampShape = RampShape::RampLinear;
+};
+
+struct CompiledInput
+{
+    int streamId; // -1 if const or not connected
+    float constValue;
+    bool isConst;
+};
+
+struct CompiledOutput
+{
+    int firstStream; // into CompiledGraph::outputStreamIds
+    int numStreams;
+};
+
+struct CompiledNode
+{
+    Node* node; // the full node, only read for state that some nodes keep, e.g. meters and expressions
+    int nodeId; // for reporting errors
+    NodeType type;
+    int firstInput; // into CompiledGraph::inputs
+    int numInputs;
+    int firstOutput; // into CompiledGraph::outputs
+    int numOutputs;
+    int firstValueStream; // into CompiledGraph::valueStreamIds
+    int numValueStreams;
+};
+
+/**
+ The graph as evaluation sees it, built by DataInstance::compile() on the message thread whenever the graph changes.
+ Nodes are stored in the order they have to run, with their connections packed into flat arrays alongside, so the audio thread reads straight through a few cache lines rather than chasing through every node's parameter objects with their strings and editor flags.
+ */
+struct CompiledGraph
+{
+    alignas(64) CompiledNode nodes[NUM_NODES];
+    alignas(64) CompiledInput inputs[NUM_NODES * NUM_PARAMS];
+    alignas(64) CompiledOutput outputs[NUM_NODES * NUM_PARAMS];
+    alignas(64) int outputStreamIds[NUM_NODES * NUM_PARAMS * 8];
+    alignas(64) int valueStreamIds[NUM_NODES * NUM_PARAMS * 8]; // each node's value output streams again, so their envelopes can be run as soon as it has set them
+    
+    int numNodes = 0;
+    int numInputs = 0;
+    int numOutputs = 0;
+    int numOutputStreams = 0;
+    int numValueStreams = 0;
+    
+    const CompiledInput& getInput(const CompiledNode& node, int paramId) const {return inputs[node.firstInput + paramId];}
+    const CompiledOutput& getOutput(const CompiledNode& node, int paramId) const {return outputs[node.firstOutput + paramId];}
+};
+
 struct DataInstance
 {
     int i;
     Node* nodes[NUM_NODES]; // could be vector, but probably not for the best TODO: maybe change to std::unique_ptr or even owned array?? im giving up rn tbh
     AudioStream audioStreams[NUM_AUDIO_STREAMS];
     ValueStream valueStreams[NUM_VALUE_STREAMS];
+    ValueStreamEnvelopes envelopes;
+    
+    std::atomic<float> displayValues[NUM_VALUE_STREAMS]; // each value stream's value as of the end of the last block, for the editor, which can't read the envelopes while they're run; NAN if it wasn't set
     
     DataInstance()
     {
@@ -823,7 +1317,11 @@ struct DataInstance
             audioStreams[i].selfId = i;
         
         for (int i = 0; i < NUM_VALUE_STREAMS; i++)
+        {
             valueStreams[i].selfId = i;
+            valueStreams[i].envelopes = &envelopes;
+            displayValues[i] = NAN;
+        }
         
         for (int i = 0; i < NUM_NODES; i++)
             nodes[i] = nullptr; // maybe?
@@ -850,30 +1348,9 @@ struct DataInstance
             if (child->getTagName() == "node")
             {
 //                DBG(child->toString());
-                switch ((NodeType) child->getChildByName("type")->getAllSubText().getIntValue())
-                {
-                    case NodeType::MainInput:
-                        nodes[nodeId++] = new Data::MainInputNode(child);
-                        break;
-                    case NodeType::MainOutput:
-                        nodes[nodeId++] = new Data::MainOutputNode(child);
-                        break;
-                    case NodeType::Gain:
-                        nodes[nodeId++] = new Data::GainNode(child);
-                        break;
-                    case NodeType::Level:
-                        nodes[nodeId++] = new Data::LevelNode(child);
-                        break;
-                    case NodeType::Correlation:
-                        nodes[nodeId++] = new Data::CorrelationNode(child);
-                        break;
-                    case NodeType::Loudness:
-                        nodes[nodeId++] = new Data::LoudnessNode(child);
-                        break;
-                    case NodeType::Maths:
-                        nodes[nodeId++] = new Data::MathsNode(child);
-                        break;
-                }
+                auto node = createNode(child);
+                
+                if (node != nullptr) nodes[nodeId++] = node;
                 
             } else if (child->getTagName() == "valueStream")
             {
@@ -928,14 +1405,81 @@ struct DataInstance
     
     void prepareStreams();
     void prepare();
+    void prepareToPlay(double sampleRate, const juce::AudioChannelSet& channelSet, int samplesPerBlock, bool useDoublePrecision);
+    
+    static std::vector<double> getLoudnessChannelWeights(const juce::AudioChannelSet& channelSet); // ITU-R BS.1770
+    
+    bool isStreamInUse(ParameterType type, int streamId); // connected at both ends
+    void prepareAudioStreamBuffers(); // points the buffers of streams in use at their arena slots
+    
+    template <typename SampleType>
+    void referToArena(juce::AudioBuffer<SampleType>& buffer, SampleType* const* channels);
+    
+    void compile(); // orders and packs the graph for evaluate()
+    void compile(int nodeId, char* visitState);
+    
+    void evaluate(); // in whichever precision prepareToPlay() asked for
+    
+    template <typename SampleType> void evaluate();
+    template <typename SampleType> void evaluate(const CompiledNode& compiledNode);
+    
+    static Node* createNode(juce::XmlElement* elem); // of the type saved in elem, or nullptr if the type isn't known
+    void insertNode(int nodeId, Node* node); // shifting up any nodes from nodeId
+    Node* findNode(int uid, int nodeIdHint); // nodeIdHint is checked first, since most edits don't move a node
     
-    void evaluate();
-    void evaluate(int streamId, ParameterType type);
-    void evaluate(int nodeId);
+    // moves what the audio thread carries between blocks (meters, MIDI thinning) over from the instance being swapped out, matching nodes by uid.
+    // Only called by the owner of the swap, so neither instance is being processed or edited
+    void takeRuntimeStateFrom(DataInstance& previous);
     
     int getNextNodeId();
     int getNextStreamId(ParameterType type);
     
+    SpectrumCache* getSpectrum(int streamId); // pushes the stream into its spectrum at most once per block
+    const juce::AudioBuffer<float>& getAnalysisBuffer(int streamId); // the stream as floats, for the meters that only take floats
+    const float* getRamp(int streamId, bool asGain, int numSamples); // generates the stream's per-sample ramp at most once per block; numSamples is the host's block
+    void prepareRampIndices();
+    
+    juce::HeapBlock<float> rampIndices; // 1, 2, 3... for filling linear ramps with vector operations
+    int numRampIndices = 0;
+    static constexpr int rampChunkSize = 32; // samples between closed form values of a decibel linear ramp
+    
+    float getInputValue(const CompiledNode& compiledNode, int paramId, float fallback);
+    void setOutputValue(const CompiledNode& compiledNode, int paramId, float value);
+    
+    bool isSilent(int audioStreamId) {return audioStreamId == -1 || audioStreams[audioStreamId].isSilent;}
+    void writeSilence(const CompiledNode& compiledNode, int paramId); // only clears streams that weren't already silent
+    void setNotSilent(const CompiledNode& compiledNode, int paramId);
+    
+    double getTailSeconds() {return tailSeconds;}
+    
+    CompiledGraph compiled;
+    
+    double sampleRate = 44100.0;
+    int samplesPerBlock = 512;
+    int numChannels = 0; // of the audio stream buffers, which only refer to arena memory while in use
+    juce::AudioChannelSet channelSet; // the layout of every audio stream, the same as the main bus
+    std::vector<double> loudnessChannelWeights;
+    
+    AudioStreamArena* arena = nullptr; // owned by the DataManager
+    EngineEventQueue* events = nullptr; // likewise; for reporting from the audio thread
+    
+    bool useDoublePrecision = false; // audio streams are doubles, and analysis reads them through analysisBuffer
+    juce::AudioBuffer<float> analysisBuffer;
+    int blockIndex = 0;
+    
+    HostParameters* hostParameters = nullptr; // owned by the processor
+    
+    juce::MidiBuffer* midiOutput = nullptr; // set by the processor for each block
+    int numSamples = 0; // in the block being evaluated, which may be fewer than samplesPerBlock
+    
+   #if FXGRAPH_SWAP_LATENCY_STATS
+    juce::int64 queuedTicks = 0; // when finishEditing() queued this instance
+   #endif
+    
+    // how long after the input falls silent the graph's value outputs can still change, worked out by compile()
+    double tailSeconds = 0.0;
+    static constexpr double envelopeSettleTimeConstants = 7.0; // to within 60dB
+    
     juce::AudioBuffer<float>* tempInpt;
 };
 }
@@ -954,8 +1498,8 @@ public:
     DataManager();
     ~DataManager();
     
-    void addNode(int index, NodeType type, juce::Point<float> position);
-    void addNode(Data::DataInstance* instance, int index, NodeType type, juce::Point<float> position);
+    void addNode(int index, NodeType type, juce::Point<float> position, int uid = -1); // a uid given is reused, e.g. when redoing
+    void addNode(Data::DataInstance* instance, int index, NodeType type, juce::Point<float> position, int uid = -1);
     
     void removeStream(ParameterType type, int streamid);
     void removeStream(Data::DataInstance* instance, ParameterType type, int streamid);
@@ -963,50 +1507,131 @@ public:
     void removeNode(int nodeId);
     void removeNode(Data::DataInstance* instance, int nodeId);
     
+    int connect(ParameterType type, Data::Endpoint producer, Data::Endpoint consumer); // returns the new stream's id, or -1
+    void disconnect(ParameterType type, Data::Endpoint consumer);
+    int getStreamId(ParameterType type, Data::Endpoint consumer); // of the stream into consumer, in the inactive instance
+    
+    Data::Endpoint getProducer(ParameterType type, int streamId);
+    Data::Endpoint getProducer(Data::DataInstance* instance, ParameterType type, int streamId);
+    Data::Endpoint getConsumer(ParameterType type, int streamId);
+    Data::Endpoint getConsumer(Data::DataInstance* instance, ParameterType type, int streamId);
+    
+    Data::StreamSettings getStreamSettings(int valueStreamId);
+    void setStreamSettings(int valueStreamId, const Data::StreamSettings& settings);
+    
+    float getDisplayValue(int valueStreamId); // any thread; the stream's value in the active instance as of its last block, or NAN
+    
+    void perform(EditCommand* command); // applies the command as one edit, and keeps it so it can be undone
+    void undo();
+    void redo();
+    bool canUndo();
+    bool canRedo();
+    void clearHistory(); // for edits that aren't commands but would change what the commands refer to
+    
     Data::MainOutputNode* getOutputNode(Data::DataInstance* instance);
     Data::MainOutputNode* getOutputNode();
     
     Data::MainInputNode* getInputNode(Data::DataInstance* instance);
     Data::MainInputNode* getInputNode();
     
-    Data::DataInstance* activeInstance;
-    Data::DataInstance* inactiveInstance;
+    // the audio thread swaps this in realise() while the GUI reads it, so it's only ever loaded through here
+    Data::DataInstance* getActiveInstance() {return activeInstance.load(std::memory_order_acquire);}
+    Data::DataInstance* inactiveInstance; // nullptr until the first edit; always valid between startEditing() and finishEditing()
+    
+    void setHostParameters(HostParameters* hostParameters);
+    void prepareToPlay(double sampleRate, const juce::AudioChannelSet& channelSet, int samplesPerBlock, bool useDoublePrecision); // prepares both instances, or just the one if nothing has been edited yet
     
     void startEditing();
     void finishEditing();
-    void realise();
+    void realise(); // audio thread, between startProcessing() and evaluating; swaps in the queued change, if there is one
     
     void registerOneTimeRealisationListener(const std::function<void()>& f) 
     {
         oneTimeListenerFlag = true;
         oneTimeRealisationListener = f;
+        events.setDelivering(true);
     }
     
-    void registerRealisationListener(const std::function<void()>& f)
+    void registerRealisationListener(const std::function<void()>& f) // the engine events are only delivered while there's a listener
     {
         realisationListener = f;
+        events.setDelivering(true);
+    }
+    
+    void removeRealisationListener()
+    {
+        realisationListener = [] () {};
+        oneTimeListenerFlag = false;
+        events.setDelivering(false);
     }
     
     bool isEditing() {return editing;};
     
+   #if FXGRAPH_SWAP_LATENCY_STATS
+    SwapLatencyStats& getSwapLatency() {return swapLatency;}
+   #endif
+    
     bool isProcessing() {return processing;}
     
     void startProcessing() {
         processing = true;
+        processingStartTicks = juce::Time::getHighResolutionTicks();
     }
     
-    void finishProcessing() {
-        processing = false;
-    }
+    void finishProcessing(); // and reports an overload if the block took longer than it lasts
+    
+    AudioProbe probe; // copied into by finishProcessing() while the inspector shows an audio stream
+    
+    LayoutModel layout; // message thread; edited directly rather than through the instances, since none of it is heard
+    
+    juce::XmlElement* serialise(); // the active graph, with each node's layout saved in with it
+    void deserialise(juce::XmlElement* element); // into the inactive instance and the layout, between startEditing() and finishEditing()
 private:
+    void writeProbe(int audioStreamId); // audio thread
+    AudioStreamArena arena;
+    
     Data::DataInstance a;
-    Data::DataInstance b;
+    std::unique_ptr<Data::DataInstance> b; // only made once something is edited, since most instances a host makes are never edited
+    
+    void createInactiveInstance();
     
-    bool editing;
-    bool changeQueued;
+    void apply(EditCommand* command); // as one edit, unless it only changes the layout
+    void revert(EditCommand* command);
+    
+    std::unique_ptr<EditHistory> history;
+    
+    /**
+     Either thread can swap the instances: the audio thread at the start of a block, or the message thread in finishEditing() while no block is being processed.
+     Whoever moves the state from queued to swapping owns the swap, so a change is never swapped in twice, and the other thread waits out the few instructions it takes rather than reading the pointers halfway through.
+     processing and swapState are both sequentially consistent, so the message thread can't miss a block starting while it swaps, and the audio thread can't miss a swap starting before its block.
+     */
+    enum SwapState
+    {
+        idle,
+        queued,
+        swapping
+    };
+    
+    std::atomic<int> swapState {idle};
+    std::atomic<Data::DataInstance*> activeInstance {nullptr};
+    
+    bool unqueue(); // message thread; takes back a change the audio thread hasn't swapped in yet
+    void pruneLayout(); // message thread; erases the layout of nodes that are gone from both instances
+    void swapInstances(); // only by the owner of the swap
+    
+    bool editing = false; // message thread only
     bool oneTimeListenerFlag = false;
     
-    bool processing;
+    std::atomic<bool> processing {false};
+    juce::int64 processingStartTicks = 0; // audio thread only
+    
+    EngineEventQueue events;
+    void handleEngineEvent(const EngineEvent& event); // message thread
+    
+   #if FXGRAPH_SWAP_LATENCY_STATS
+    SwapLatencyStats swapLatency;
+    Data::DataInstance* lastProcessedInstance = nullptr; // audio thread only
+   #endif
     
     std::function<void()> oneTimeRealisationListener = [] () {};
     std::function<void()> realisationListener = [] () {};
@@ -0,0 +1,305 @@
+/*
+  ==============================================================================
+  
+    EditHistory.cpp
+    Created: 19 Oct 2026 4:02:18pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include "EditHistory.h"
+
+static Edit::Connection readConnection(DataManager& dataManager, ParameterType type, Data::Endpoint consumer)
+{
+    Edit::Connection connection;
+    connection.type = type;
+    
+    int streamId = dataManager.getStreamId(type, consumer);
+    if (streamId == -1) return connection;
+    
+    connection.producer = dataManager.getProducer(type, streamId);
+    connection.consumer = consumer;
+    
+    if (type == ParameterType::Value)
+        connection.settings = dataManager.getStreamSettings(streamId);
+    
+    return connection;
+}
+
+static void restoreConnection(DataManager& dataManager, Edit::Connection& connection)
+{
+    if (!connection.isValid()) return;
+    
+    int streamId = dataManager.connect(connection.type, connection.producer, connection.consumer);
+    
+    if (streamId != -1 && connection.type == ParameterType::Value)
+        dataManager.setStreamSettings(streamId, connection.settings);
+}
+
+//==============================================================================
+void Edit::AddNode::apply(DataManager& dataManager)
+{
+    nodeId = dataManager.inactiveInstance->getNextNodeId();
+    
+    if (nodeId == -1) return;
+    
+    // when redone, it's the same node as before to any layout command that follows
+    dataManager.addNode(nodeId, type, position, uid);
+    
+    auto node = dataManager.inactiveInstance->nodes[nodeId];
+    
+    if (node != nullptr) uid = node->uid;
+}
+
+void Edit::AddNode::revert(DataManager& dataManager)
+{
+    if (nodeId == -1) return;
+    
+    dataManager.removeNode(nodeId);
+}
+
+//==============================================================================
+void Edit::RemoveNode::apply(DataManager& dataManager)
+{
+    auto node = dataManager.inactiveInstance->nodes[nodeId];
+    
+    if (node == nullptr || node->isGlobalLockedNode) return;
+    
+    uid = node->uid;
+    savedLayout = dataManager.layout.getLayout(uid);
+    savedNode.reset(node->serialise());
+    savedConnections.clearQuick();
+    
+    for (int paramId = 0; paramId < NUM_PARAMS; paramId++)
+    {
+        if (!node->inputParams[paramId].isActive) break;
+        
+        auto connection = readConnection(dataManager, node->inputParams[paramId].type, {nodeId, paramId});
+        
+        if (connection.isValid()) savedConnections.add(connection);
+    }
+    
+    for (int paramId = 0; paramId < NUM_PARAMS; paramId++)
+    {
+        if (!node->outputParams[paramId].isActive) break;
+        
+        for (int i = 0; i < 8; i++)
+        {
+            int streamId = node->outputParams[paramId].streamIds[i];
+            if (streamId == -1) break;
+            
+            auto connection = readConnection(dataManager, node->outputParams[paramId].type, dataManager.getConsumer(node->outputParams[paramId].type, streamId));
+            
+            if (connection.isValid()) savedConnections.add(connection);
+        }
+    }
+    
+    dataManager.removeNode(nodeId);
+}
+
+void Edit::RemoveNode::revert(DataManager& dataManager)
+{
+    if (savedNode == nullptr) return;
+    
+    auto node = Data::DataInstance::createNode(savedNode.get());
+    
+    if (node == nullptr) return;
+    
+    node->uid = uid;
+    
+    // the saved stream ids are stale by now, so the streams are made again from the saved connections
+    for (int paramId = 0; paramId < NUM_PARAMS; paramId++)
+    {
+        node->inputParams[paramId].streamId = -1;
+        
+        for (int i = 0; i < 8; i++)
+            node->outputParams[paramId].streamIds[i] = -1;
+    }
+    
+    dataManager.inactiveInstance->insertNode(nodeId, node);
+    dataManager.layout.setLayout(uid, savedLayout);
+    
+    for (auto& connection : savedConnections)
+        restoreConnection(dataManager, connection);
+}
+
+//==============================================================================
+Edit::Connect::Connect(ParameterType type, Data::Endpoint producer, Data::Endpoint consumer)
+{
+    connection.type = type;
+    connection.producer = producer;
+    connection.consumer = consumer;
+}
+
+void Edit::Connect::apply(DataManager& dataManager)
+{
+    auto& input = dataManager.inactiveInstance->nodes[connection.consumer.nodeId]->inputParams[connection.consumer.paramId];
+    
+    wasConst = input.isConst;
+    replaced = readConnection(dataManager, connection.type, connection.consumer);
+    
+    isConnected = dataManager.connect(connection.type, connection.producer, connection.consumer) != -1;
+}
+
+void Edit::Connect::revert(DataManager& dataManager)
+{
+    if (!isConnected) return;
+    
+    dataManager.disconnect(connection.type, connection.consumer);
+    
+    restoreConnection(dataManager, replaced);
+    
+    dataManager.inactiveInstance->nodes[connection.consumer.nodeId]->inputParams[connection.consumer.paramId].isConst = wasConst;
+}
+
+//==============================================================================
+Edit::Disconnect::Disconnect(ParameterType type, Data::Endpoint consumer)
+{
+    connection.type = type;
+    connection.consumer = consumer;
+}
+
+void Edit::Disconnect::apply(DataManager& dataManager)
+{
+    connection = readConnection(dataManager, connection.type, connection.consumer);
+    
+    dataManager.disconnect(connection.type, connection.consumer);
+}
+
+void Edit::Disconnect::revert(DataManager& dataManager)
+{
+    restoreConnection(dataManager, connection);
+}
+
+//==============================================================================
+void Edit::SetConst::apply(DataManager& dataManager)
+{
+    auto& input = dataManager.inactiveInstance->nodes[nodeId]->inputParams[paramId];
+    
+    prevIsConst = input.isConst;
+    prevValue = input.constValue;
+    
+    input.isConst = isConst;
+    input.constValue = value;
+}
+
+void Edit::SetConst::revert(DataManager& dataManager)
+{
+    auto& input = dataManager.inactiveInstance->nodes[nodeId]->inputParams[paramId];
+    
+    input.isConst = prevIsConst;
+    input.constValue = prevValue;
+}
+
+//==============================================================================
+// the id of the stream into consumer in the inactive instance, resolving consumer from the stream id the command was made with the first time
+static int resolveStream(DataManager& dataManager, int streamId, Data::Endpoint& consumer)
+{
+    if (consumer.nodeId == -1)
+        consumer = dataManager.getConsumer(ParameterType::Value, streamId);
+    
+    if (consumer.nodeId == -1) return -1;
+    
+    return dataManager.getStreamId(ParameterType::Value, consumer);
+}
+
+void Edit::SetEnvelope::apply(DataManager& dataManager)
+{
+    int id = resolveStream(dataManager, streamId, consumer);
+    
+    if (id == -1) return;
+    
+    auto settings = dataManager.getStreamSettings(id);
+    auto& settingsMs = time == Time::Attack ? settings.msAttack : settings.msRelease;
+    
+    prevMs = settingsMs;
+    settingsMs = ms;
+    
+    dataManager.setStreamSettings(id, settings);
+}
+
+void Edit::SetEnvelope::revert(DataManager& dataManager)
+{
+    int id = resolveStream(dataManager, streamId, consumer);
+    
+    if (id == -1) return;
+    
+    // only the time this command set, so later edits to the stream's other settings survive undoing it
+    auto settings = dataManager.getStreamSettings(id);
+    (time == Time::Attack ? settings.msAttack : settings.msRelease) = prevMs;
+    
+    dataManager.setStreamSettings(id, settings);
+}
+
+//==============================================================================
+void Edit::SetRampShape::apply(DataManager& dataManager)
+{
+    int id = resolveStream(dataManager, streamId, consumer);
+    
+    if (id == -1) return;
+    
+    auto settings = dataManager.getStreamSettings(id);
+    
+    prevShape = settings.rampShape;
+    settings.rampShape = shape;
+    
+    dataManager.setStreamSettings(id, settings);
+}
+
+void Edit::SetRampShape::revert(DataManager& dataManager)
+{
+    int id = resolveStream(dataManager, streamId, consumer);
+    
+    if (id == -1) return;
+    
+    auto settings = dataManager.getStreamSettings(id);
+    settings.rampShape = prevShape;
+    
+    dataManager.setStreamSettings(id, settings);
+}
+
+//==============================================================================
+void Edit::MoveNode::apply(DataManager& dataManager)
+{
+    dataManager.layout.setPosition(uid, to);
+}
+
+void Edit::MoveNode::revert(DataManager& dataManager)
+{
+    dataManager.layout.setPosition(uid, from);
+}
+
+//==============================================================================
+void EditHistory::push(EditCommand* command)
+{
+    // anything that could have been redone no longer follows on from this
+    commands.removeRange(nextIndex, commands.size() - nextIndex);
+    
+    commands.add(command);
+    
+    if (commands.size() > maxCommands)
+        commands.remove(0);
+    
+    nextIndex = commands.size();
+}
+
+EditCommand* EditHistory::stepBack()
+{
+    if (!canStepBack()) return nullptr;
+    
+    return commands[--nextIndex];
+}
+
+EditCommand* EditHistory::stepForward()
+{
+    if (!canStepForward()) return nullptr;
+    
+    return commands[nextIndex++];
+}
+
+void EditHistory::clear()
+{
+    commands.clear();
+    nextIndex = 0;
+}
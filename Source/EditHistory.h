@@ -0,0 +1,203 @@
+/*
+  ==============================================================================
+  
+    EditHistory.h
+    Created: 19 Oct 2026 4:02:18pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DataManager.h"
+
+/**
+ One edit to the graph, small enough to keep hundreds of in memory.
+ Commands refer to nodes and parameters by id rather than by pointer or stream id, so they stay valid as the instances are swapped and copied. Undo always reverts the most recent command first, so the ids a command saw when it was applied are the ids it sees again when it's reverted.
+ apply() and revert() are called between DataManager::startEditing() and DataManager::finishEditing(), and only edit the inactive instance.
+ Commands that only change the layout are the exception: they edit the DataManager's LayoutModel directly, and refer to nodes by uid, since no instance is involved. Nodes keep their uid when an add or remove is undone and redone, so those uids stay valid too.
+ */
+struct EditCommand
+{
+    virtual ~EditCommand() {};
+    
+    virtual void apply(DataManager& dataManager) = 0;
+    virtual void revert(DataManager& dataManager) = 0;
+    
+    virtual bool isLayoutOnly() {return false;}
+};
+
+namespace Edit
+{
+
+struct Connection // a stream as the commands remember it, independent of its id
+{
+    ParameterType type = ParameterType::Value;
+    Data::Endpoint producer;
+    Data::Endpoint consumer;
+    Data::StreamSettings settings;
+    
+    bool isValid() {return producer.nodeId != -1 && consumer.nodeId != -1;}
+};
+
+class AddNode : public EditCommand
+{
+public:
+    AddNode(NodeType type_, juce::Point<float> position_) : type(type_), position(position_) {};
+    
+    void apply(DataManager& dataManager) override;
+    void revert(DataManager& dataManager) override;
+    
+private:
+    NodeType type;
+    juce::Point<float> position;
+    
+    int nodeId = -1;
+    int uid = -1; // given to the node again when this is redone
+};
+
+class RemoveNode : public EditCommand
+{
+public:
+    RemoveNode(int nodeId_) : nodeId(nodeId_) {};
+    
+    void apply(DataManager& dataManager) override;
+    void revert(DataManager& dataManager) override;
+    
+private:
+    int nodeId;
+    int uid = -1;
+    
+    std::unique_ptr<juce::XmlElement> savedNode;
+    LayoutModel::NodeLayout savedLayout; // removing the node erases its layout, so it's put back from here
+    juce::Array<Connection> savedConnections;
+};
+
+class Connect : public EditCommand
+{
+public:
+    Connect(ParameterType type, Data::Endpoint producer, Data::Endpoint consumer);
+    
+    void apply(DataManager& dataManager) override;
+    void revert(DataManager& dataManager) override;
+    
+private:
+    Connection connection;
+    Connection replaced; // whatever was already connected to the consumer
+    bool wasConst = false;
+    
+    bool isConnected = false;
+};
+
+class Disconnect : public EditCommand
+{
+public:
+    Disconnect(ParameterType type, Data::Endpoint consumer);
+    
+    void apply(DataManager& dataManager) override;
+    void revert(DataManager& dataManager) override;
+    
+private:
+    Connection connection;
+};
+
+class SetConst : public EditCommand
+{
+public:
+    SetConst(int nodeId_, int paramId_, bool isConst_, float value_) : nodeId(nodeId_), paramId(paramId_), isConst(isConst_), value(value_) {};
+    
+    void apply(DataManager& dataManager) override;
+    void revert(DataManager& dataManager) override;
+    
+private:
+    int nodeId;
+    int paramId;
+    
+    bool isConst;
+    float value;
+    
+    bool prevIsConst = false;
+    float prevValue = 0;
+};
+
+// the stream id is the one the inspector shows; it's resolved to the stream's consumer the first time the command is applied, in the instance being edited, and the consumer is used from then on
+class SetEnvelope : public EditCommand
+{
+public:
+    enum class Time {Attack, Release};
+    
+    SetEnvelope(int streamId_, Time time_, float ms_) : streamId(streamId_), time(time_), ms(ms_) {};
+    
+    void apply(DataManager& dataManager) override;
+    void revert(DataManager& dataManager) override;
+    
+private:
+    int streamId;
+    Data::Endpoint consumer;
+    
+    Time time;
+    float ms;
+    
+    float prevMs = 0;
+};
+
+class SetRampShape : public EditCommand
+{
+public:
+    SetRampShape(int streamId_, RampShape shape_) : streamId(streamId_), shape(shape_) {};
+    
+    void apply(DataManager& dataManager) override;
+    void revert(DataManager& dataManager) override;
+    
+private:
+    int streamId;
+    Data::Endpoint consumer;
+    
+    RampShape shape;
+    RampShape prevShape = RampShape::RampLinear;
+};
+
+class MoveNode : public EditCommand
+{
+public:
+    MoveNode(int uid_, juce::Point<float> from_, juce::Point<float> to_) : uid(uid_), from(from_), to(to_) {};
+    
+    void apply(DataManager& dataManager) override;
+    void revert(DataManager& dataManager) override;
+    
+    bool isLayoutOnly() override {return true;}
+    
+private:
+    int uid;
+    
+    juce::Point<float> from;
+    juce::Point<float> to;
+};
+    
+}
+
+/**
+ The undo and redo log: a list of commands and a cursor into it.
+ Everything before the cursor can be undone and everything after it can be redone; pushing a new command discards the redo side, and the oldest commands are dropped once there are more than maxCommands.
+ */
+class EditHistory
+{
+public:
+    static constexpr int maxCommands = 256;
+    
+    void push(EditCommand* command); // takes ownership
+    
+    EditCommand* stepBack(); // the command to revert, or nullptr
+    EditCommand* stepForward(); // the command to apply again, or nullptr
+    
+    bool canStepBack() {return nextIndex > 0;}
+    bool canStepForward() {return nextIndex < commands.size();}
+    
+    void clear();
+    
+private:
+    juce::OwnedArray<EditCommand> commands;
+    int nextIndex = 0;
+};
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+  
+    EngineEvents.cpp
+    Created: 19 Oct 2026 8:36:05pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include "EngineEvents.h"
+
+EngineEventQueue::EngineEventQueue()
+{
+    self = this;
+}
+
+EngineEventQueue::~EngineEventQueue()
+{
+    stopTimer();
+}
+
+bool EngineEventQueue::push(const EngineEvent& event)
+{
+    if (!delivering.load(std::memory_order_relaxed)) return false;
+    
+    const auto scope = fifo.write(1);
+    
+    if (scope.blockSize1 == 0)
+    {
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    events[scope.startIndex1] = event;
+    
+    return true;
+}
+
+void EngineEventQueue::post(const EngineEvent& event)
+{
+    if (!delivering) return;
+    
+    if (!juce::MessageManager::existsAndIsCurrentThread())
+    { // e.g. a host restoring state on its own thread
+        juce::MessageManager::callAsync([queue = self, event] () {
+            if (auto* q = queue.get()) q->post(event);
+        });
+        
+        return;
+    }
+    
+    posted.add(event);
+}
+
+void EngineEventQueue::setDelivering(bool shouldDeliver)
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+    
+    delivering = shouldDeliver;
+    
+    if (shouldDeliver)
+    {
+        startTimer(drainIntervalMs);
+        return;
+    }
+    
+    stopTimer();
+    posted.clear();
+    
+    fifo.read(fifo.getNumReady()); // nobody is left to hear them
+}
+
+void EngineEventQueue::timerCallback()
+{
+    // the posted events are taken first, since a listener may post more
+    auto postedEvents = std::move(posted);
+    posted.clear();
+    
+    for (auto& event : postedEvents)
+        onEvent(event);
+    
+    for (int numReady = fifo.getNumReady(); numReady > 0; numReady--)
+    {
+        EngineEvent event;
+        
+        {
+            const auto scope = fifo.read(1);
+            event = events[scope.startIndex1];
+        } // released before the listener runs, so the slot is free again as soon as possible
+        
+        onEvent(event);
+    }
+}
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+  
+    EngineEvents.h
+    Created: 19 Oct 2026 8:36:05pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct EngineEvent
+{
+    enum Type
+    {
+        realised, // a queued edit has been swapped in
+        overload, // a block took longer to process than it lasts
+        error
+    };
+    
+    enum Error
+    {
+        none,
+        nonFiniteValue // a node produced NaN or infinity, and 0 was sent on instead
+    };
+    
+    Type type = realised;
+    float load = 0; // overload: processing time over the length of the block
+    Error error = none;
+    int nodeId = -1; // error: the node it came from
+};
+
+/**
+ Carries events from the audio thread to the message thread without the audio thread ever allocating or locking.
+ The audio thread writes into a fixed ring of events through an AbstractFifo, and a timer on the message thread drains it; if the message thread falls far enough behind for the ring to fill, further events are dropped and counted rather than blocking.
+ Only the audio thread may push(). Events raised anywhere else, like a swap done while nothing was processing, are post()ed instead. Off the message thread they are passed over with callAsync first, so the posted list is only ever touched on the message thread, and they are delivered by the same timer, so listeners always hear about things in the same place.
+ Nothing is delivered, and the timer doesn't run, until setDelivering(true), so an instance nobody is listening to (e.g. one the host never opens an editor for) costs nothing; events raised in the meantime are ignored rather than counted as dropped.
+ */
+class EngineEventQueue : private juce::Timer
+{
+public:
+    EngineEventQueue();
+    ~EngineEventQueue() override;
+    
+    bool push(const EngineEvent& event); // audio thread; false if the queue was full or nobody is listening
+    void post(const EngineEvent& event); // any thread but the audio thread
+    
+    void setDelivering(bool shouldDeliver); // message thread
+    
+    int getNumDropped() {return numDropped.load();}
+    
+    std::function<void(const EngineEvent&)> onEvent = [] (const EngineEvent&) {}; // message thread
+    
+    static constexpr int capacity = 256;
+    static constexpr int drainIntervalMs = 15;
+    
+private:
+    void timerCallback() override;
+    
+    juce::AbstractFifo fifo {capacity};
+    EngineEvent events[capacity];
+    
+    std::atomic<int> numDropped {0};
+    std::atomic<bool> delivering {false};
+    
+    juce::Array<EngineEvent> posted; // message thread only
+    
+    juce::WeakReference<EngineEventQueue> self; // made up front, so copying it for callAsync is safe from any thread
+    
+    JUCE_DECLARE_WEAK_REFERENCEABLE (EngineEventQueue)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EngineEventQueue)
+};
@@ -31,8 +31,13 @@ Envelope::Envelope(float msAttack_, float msRelease_, float blockRate_)
 
 void Envelope::updateCoef()
 {
-    coefA = exp( -1000.0 / ( msAttack * blockRate) );
-    coefR = exp( -1000.0 / ( msRelease * blockRate) );
+    coefA = getCoefficient(msAttack, blockRate);
+    coefR = getCoefficient(msRelease, blockRate);
+}
+
+float Envelope::getCoefficient(float ms, float blockRate)
+{
+    return exp( -1000.0 / ( ms * blockRate) );
 }
 
 void Envelope::setMsAttack(float ms_)
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <JuceHeader.h>
 
 class Envelope
 {
@@ -28,6 +29,7 @@ public:
     
     void run(float inpt, float &curr); // sets curr by reference
     
+    static float getCoefficient(float ms, float blockRate);
     
 private:
     float msAttack;
@@ -38,3 +40,106 @@ private:
     
     void updateCoef();
 };
+
+/**
+ The envelopes of a fixed number of value streams, stored as structure-of-arrays.
+ Streams only set their target while the graph is evaluated; process() then runs the attack/release step for the streams a node writes as soon as it has run, so nodes later in the same block read the smoothed value rather than last block's.
+ */
+template <int Size>
+class EnvelopeBank
+{
+public:
+    EnvelopeBank()
+    {
+        blockRate = 44100.0f;
+        
+        const float coef = Envelope::getCoefficient(35, blockRate);
+        
+        for (int i = 0; i < Size; i++)
+        {
+            target[i] = current[i] = previous[i] = 0.0f;
+            msAttack[i] = msRelease[i] = 35;
+            coefA[i] = coefR[i] = coef;
+        }
+    }
+    
+    void setMsAttack(int index, float ms)
+    {
+        jassert(ms > 0.0);
+        msAttack[index] = ms;
+        coefA[index] = Envelope::getCoefficient(ms, blockRate);
+    }
+    float getMsAttack(int index) {return msAttack[index];}
+    
+    void setMsRelease(int index, float ms)
+    {
+        jassert(ms > 0.0);
+        msRelease[index] = ms;
+        coefR[index] = Envelope::getCoefficient(ms, blockRate);
+    }
+    float getMsRelease(int index) {return msRelease[index];}
+    
+    void setBlockRate(float blockRate_)
+    {
+        jassert(blockRate_ > 0.0);
+        blockRate = blockRate_;
+        
+        for (int i = 0; i < Size; i++)
+        {
+            coefA[i] = Envelope::getCoefficient(msAttack[i], blockRate);
+            coefR[i] = Envelope::getCoefficient(msRelease[i], blockRate);
+        }
+    }
+    float getBlockRate() {return blockRate;}
+    
+    void setTarget(int index, float value) {jassert(std::isfinite(value)); target[index] = value;} // anything else never leaves the state
+    float getTarget(int index) {return target[index];}
+    void snapTo(int index, float value) {jassert(std::isfinite(value)); target[index] = current[index] = previous[index] = value;} // jumps straight to value without smoothing
+    
+    float getValue(int index) {return current[index];}
+    float getPrevValue(int index) {return previous[index];}
+    
+    void copy(int fromIndex, int toIndex) // copies the state and settings of one envelope onto another
+    {
+        target[toIndex] = target[fromIndex];
+        current[toIndex] = current[fromIndex];
+        previous[toIndex] = previous[fromIndex];
+        msAttack[toIndex] = msAttack[fromIndex];
+        msRelease[toIndex] = msRelease[fromIndex];
+        coefA[toIndex] = coefA[fromIndex];
+        coefR[toIndex] = coefR[fromIndex];
+    }
+    
+    void copySettingsFrom(const EnvelopeBank& other) // copies attack and release times without recomputing any coefficients
+    {
+        blockRate = other.blockRate;
+        
+        std::copy(other.msAttack, other.msAttack + Size, msAttack);
+        std::copy(other.msRelease, other.msRelease + Size, msRelease);
+        std::copy(other.coefA, other.coefA + Size, coefA);
+        std::copy(other.coefR, other.coefR + Size, coefR);
+    }
+    
+    void process(const int* indices, int numIndices) // one attack/release step for each envelope given
+    {
+        // the indices are whichever streams a node happens to write, so they're gathered one at a time rather than in SIMD registers
+        for (int n = 0; n < numIndices; n++)
+        {
+            const int i = indices[n];
+            
+            previous[i] = current[i];
+            current[i] = target[i] + (target[i] > current[i] ? coefA[i] : coefR[i]) * (current[i] - target[i]); // if increasing, then attack, else release
+        }
+    }
+    
+private:
+    alignas (32) float target[Size];
+    alignas (32) float current[Size];
+    alignas (32) float previous[Size];
+    alignas (32) float coefA[Size];
+    alignas (32) float coefR[Size];
+    
+    float msAttack[Size];
+    float msRelease[Size];
+    float blockRate;
+};
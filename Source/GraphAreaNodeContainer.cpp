@@ -15,10 +15,14 @@
 
 /**
  Handles the transformations for the graph area for zooming and panning. All logic should ideally be implemented on the PluginEditor
+ Children are laid out in graph space and each given the view's transform, so their own bounds are still where their nodes are saved, and the spatial grid and collisions don't need to know about the view at all.
+ Only nodes on screen have a child at all; the rest of the visible ones, when zoomed too far out for a component to be worth it, are drawn by paint() instead.
  */
-GraphAreaNodeContainer::GraphAreaNodeContainer()
+GraphAreaNodeContainer::GraphAreaNodeContainer(juce::OwnedArray<Common::Node>& nodes, std::shared_ptr<DataManager> d) : graphNodes(nodes)
 {
-//    setTransform(juce::AffineTransform().scale(0.5f));
+    dataManager = d;
+    
+    setInterceptsMouseClicks(false, true); // the empty canvas belongs to the editor, for panning
 }
 
 GraphAreaNodeContainer::~GraphAreaNodeContainer()
@@ -27,8 +31,140 @@ GraphAreaNodeContainer::~GraphAreaNodeContainer()
 
 void GraphAreaNodeContainer::paint (juce::Graphics& g)
 {
+    auto visibleArea = getVisibleArea().getSmallestIntegerContainer();
+    
+    g.addTransform(viewTransform);
+    
+    for (int nodeId = 0; nodeId < graphNodes.size(); nodeId++)
+    {
+        auto n = graphNodes[nodeId];
+        
+        if (n->component != nullptr || !n->bounds.intersects(visibleArea)) continue;
+        
+        auto node = dataManager->getActiveInstance()->nodes[nodeId];
+        
+        if (node == nullptr || node->uid != n->uid) continue; // the nodes haven't been reconciled with a realised edit yet
+        
+        paintNode(g, *n, node, nodeId == selectedNodeId);
+    }
+}
+
+void GraphAreaNodeContainer::paintNode(juce::Graphics& g, const Common::Node& n, Data::Node* node, bool isSelected)
+{
+    // the same shapes as GraphNode, less the shadow, the text of the parameters and their const values
+    auto body = n.bounds.toFloat().reduced(GraphNode::shadowSize);
+    
+    g.setColour(juce::Colour(0xff36353A));
+    g.fillRoundedRectangle(body, GraphNode::cornerRadius);
+    
+    if (node->hasOutputSide)
+    {
+        auto outputSide = body.withTrimmedTop(GraphNode::headerHeight);
+        
+        if (node->hasInputSide) outputSide.removeFromLeft(outputSide.getWidth() / 2);
+        
+        g.setColour(juce::Colour(0xff2E2F38));
+        g.fillRoundedRectangle(outputSide, GraphNode::cornerRadius);
+    }
+    
+    if (isSelected)
+    {
+        g.setColour(juce::Colour(0xa0ffffff));
+        g.drawRoundedRectangle(body, GraphNode::cornerRadius, 2.0f / viewTransform.getScaleFactor());
+    }
+    
+    for (int paramId = 0; paramId < NUM_PARAMS && node->inputParams[paramId].isActive; paramId++)
+    {
+        g.setColour(node->inputParams[paramId].type == ParameterType::Audio ? juce::Colour(0xff4CA2C5) : juce::Colour(0xffFAA21B));
+        g.fillRect(GraphNode__Parameter::getPillRect(GraphNode::getParameterBounds(n.bounds, InputOrOutput::Input, paramId), InputOrOutput::Input));
+    }
+    
+    for (int paramId = 0; paramId < NUM_PARAMS && node->outputParams[paramId].isActive; paramId++)
+    {
+        g.setColour(node->outputParams[paramId].type == ParameterType::Audio ? juce::Colour(0xff4CA2C5) : juce::Colour(0xffFAA21B));
+        g.fillRect(GraphNode__Parameter::getPillRect(GraphNode::getParameterBounds(n.bounds, InputOrOutput::Output, paramId), InputOrOutput::Output));
+    }
+    
+    if (GraphNode::headerHeight * 0.5f * viewTransform.getScaleFactor() < minReadableFontHeight) return;
+    
+    auto headerBounds = body.withHeight(GraphNode::headerHeight);
+    
+    g.setColour (juce::Colours::white);
+    g.setFont (juce::FontOptions (GraphNode::headerHeight * 0.5f));
+    g.drawText (dataManager->layout.getLabel(node), headerBounds.reduced(10.0f, 5.0f), juce::Justification::centredLeft, true);
+}
+
+void GraphAreaNodeContainer::setViewTransform(const juce::AffineTransform& transform)
+{
+    viewTransform = transform;
+    
+    for (auto child : getChildren())
+        child->setTransform(viewTransform);
+    
+    repaint();
+}
+
+juce::Rectangle<float> GraphAreaNodeContainer::getVisibleArea()
+{
+    return getLocalBounds().toFloat().transformedBy(viewTransform.inverted());
+}
+
+void GraphAreaNodeContainer::setSelectedNode(int nodeId)
+{
+    if (nodeId == selectedNodeId) return;
+    
+    selectedNodeId = nodeId;
+    repaint();
 }
 
 void GraphAreaNodeContainer::resized()
 {
 }
+
+void GraphAreaNodeContainer::childrenChanged()
+{
+    grid.clear();
+    gridIds.clear();
+    gridComponents.clearQuick();
+    
+    for (auto child : getChildren())
+    {
+        child->setTransform(viewTransform); // a new child starts out in the current view
+        
+        gridIds[child] = gridComponents.size();
+        grid.insert(gridComponents.size(), child->getBounds().toFloat());
+        gridComponents.add(child);
+    }
+}
+
+void GraphAreaNodeContainer::childBoundsChanged(juce::Component* child)
+{
+    auto found = gridIds.find(child);
+    
+    if (found == gridIds.end()) return;
+    
+    grid.move(found->second, child->getBounds().toFloat());
+}
+
+juce::Array<juce::Rectangle<float>> GraphAreaNodeContainer::getCollidingRects(juce::Component& child, float padding)
+{
+    auto thisBounds = child.getBounds().toFloat();
+    
+    juce::Array<juce::Rectangle<float>> out;
+    
+    grid.query(thisBounds.expanded(padding), gridResults);
+    
+    for (int id : gridResults)
+    {
+        auto other = gridComponents[id];
+        
+        if (other == &child) continue;
+        
+        auto b = other->getBounds().toFloat().expanded(padding);
+        
+        if (thisBounds.intersects(b))
+            out.add(b);
+    }
+    
+    return out;
+}
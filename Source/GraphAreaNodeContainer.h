@@ -11,6 +11,10 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <unordered_map>
+#include "SpatialGrid.h"
+#include "Common.h"
+#include "DataManager.h"
 
 //==============================================================================
 /*
@@ -18,12 +22,39 @@
 class GraphAreaNodeContainer  : public juce::Component
 {
 public:
-    GraphAreaNodeContainer();
+    GraphAreaNodeContainer(juce::OwnedArray<Common::Node>& nodes, std::shared_ptr<DataManager> d);
     ~GraphAreaNodeContainer() override;
 
     void paint (juce::Graphics&) override;
     void resized() override;
+    
+    void childrenChanged() override;
+    void childBoundsChanged(juce::Component* child) override;
+    
+    // the bounds of the other children, expanded by padding, that overlap child
+    juce::Array<juce::Rectangle<float>> getCollidingRects(juce::Component& child, float padding);
+    
+    void setViewTransform(const juce::AffineTransform& transform); // from graph space, which the children are laid out in, to this component
+    juce::Rectangle<float> getVisibleArea(); // in graph space
+    
+    void setSelectedNode(int nodeId); // -1 for none; only shown here for nodes without a component
+    
+    static constexpr float minReadableFontHeight = 6.0f; // names smaller than this on screen aren't drawn
 
 private:
+    void paintNode(juce::Graphics& g, const Common::Node& n, Data::Node* node, bool isSelected);
+    
+    juce::OwnedArray<Common::Node>& graphNodes;
+    std::shared_ptr<DataManager> dataManager;
+    
+    juce::AffineTransform viewTransform;
+    int selectedNodeId = -1;
+    
+    // the bounds of every child, kept up to date as they move, so collisions only look at nearby nodes
+    SpatialGrid grid { 128.0f };
+    std::unordered_map<juce::Component*, int> gridIds;
+    juce::Array<juce::Component*> gridComponents; // by grid id
+    juce::Array<int> gridResults;
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphAreaNodeContainer)
 };
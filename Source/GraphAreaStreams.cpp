@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "GraphAreaStreams.h"
+#include "EditHistory.h"
 
 //==============================================================================
 GraphAreaStreams::GraphAreaStreams(juce::OwnedArray<Common::Node>& nodes, std::shared_ptr<DataManager> d)
@@ -25,11 +26,21 @@ GraphAreaStreams::~GraphAreaStreams()
 
 bool GraphAreaStreams::hitTest(int x, int y)
 {
-    for (auto stream : streams)
+    return getStreamAt(juce::Point<int>(x, y).toFloat().transformedBy(inverseViewTransform)) != nullptr; // TODO: exclude param pill rects
+}
+
+GraphAreaStreams::Stream* GraphAreaStreams::getStreamAt(juce::Point<float> position)
+{
+    updateStreams();
+    
+    streamGrid.query(position, gridResults);
+    
+    for (int index : gridResults)
     {
-        if (stream->path->contains(x, y)) return true; // TODO: exclude param pill rects
+        if (streams[index]->path->contains(position)) return streams[index];
     }
-    return false;
+    
+    return nullptr;
 }
 
 juce::Rectangle<float> GraphAreaStreams::getStreamRectangle(Direction direction, juce::Point<float> start, juce::Point<float> end, float thickness)
@@ -116,96 +127,204 @@ juce::Path* GraphAreaStreams::createStream(juce::Array<juce::Point<float>> ancho
     return out;
 }
 
-GraphAreaStreams::Stream* GraphAreaStreams::paintStreamInternal(juce::Graphics& g, juce::Point<float> startPosition, juce::Point<float> endPosition, ParameterType type, bool addStream)
+juce::Path* GraphAreaStreams::createStream(juce::Point<float> startPosition, juce::Point<float> endPosition)
+{
+    return createStream({
+        startPosition,
+        {(startPosition.getX() + endPosition.getX()) / 2.0f, startPosition.getY()},
+        {(startPosition.getX() + endPosition.getX()) / 2.0f, endPosition.getY()},
+        endPosition
+    });
+}
+
+void GraphAreaStreams::paintStreamPath(juce::Graphics& g, const juce::Path& path, ParameterType type)
 {
-    auto streamEl = new Stream;
-    
-    streamEl->type = type;
-//    streamEl->streamId = stream.selfId;
-    
     if (type == ParameterType::Audio)
         g.setColour(juce::Colour(0xff4CA2C5));
     else
         g.setColour(juce::Colour(0xffFAA21B));
     
-//    auto inputNode = graphNodes[stream.inputNodeId];
-//    auto outputNode = graphNodes[stream.outputNodeId];
-//    
-//    // InputOrOutput is swapped because the stream inputs from the output side of the input node
-//    auto start = inputNode->component->getParameterPosition(InputOrOutput::Output, stream.inputParamId);
-//    
-//    auto end = outputNode->component->getParameterPosition(InputOrOutput::Input, stream.outputParamId);
+    g.fillPath(path);
+}
+
+void GraphAreaStreams::invalidateStreams()
+{
+    streamsDirty = true;
+    streamLayerDirty = selectedShadowDirty = true;
+    repaint();
+}
+
+void GraphAreaStreams::invalidateNode(int nodeId)
+{
+    for (auto stream : streams)
+    {
+        if (stream->producerNodeId != nodeId && stream->consumerNodeId != nodeId) continue;
+        
+        stream->isDirty = true;
+        anyStreamDirty = true;
+    }
     
-    streamEl->path.reset(createStream({
-        startPosition,
-        {(startPosition.getX() + endPosition.getX()) / 2.0f, startPosition.getY()},
-        {(startPosition.getX() + endPosition.getX()) / 2.0f, endPosition.getY()},
-        endPosition
-    }));
+    repaint();
+}
+
+void GraphAreaStreams::setViewTransform(const juce::AffineTransform& transform)
+{
+    viewTransform = transform;
+    inverseViewTransform = transform.inverted();
     
-    g.fillPath(*streamEl->path.get());
+    // the paths stay as they are, since they're in graph space; only the picture of them changes
+    streamLayerDirty = true;
+    repaint();
+}
+
+void GraphAreaStreams::addStream(const Data::Stream& stream)
+{
+    auto streamEl = new Stream;
     
-    if (addStream)
-        streams.add(streamEl);
+    streamEl->streamId = stream.selfId;
+    streamEl->type = stream.type;
+    streamEl->producerNodeId = stream.inputNodeId;
+    streamEl->producerParamId = stream.inputParamId;
+    streamEl->consumerNodeId = stream.outputNodeId;
+    streamEl->consumerParamId = stream.outputParamId;
     
-    return streamEl;
+    streams.add(streamEl);
+    
+    updateStreamPath(streams.size() - 1);
 }
 
-void GraphAreaStreams::paintStream(juce::Graphics& g, Data::Stream stream)
+void GraphAreaStreams::updateStreamPath(int index)
 {
-    auto inputNode = graphNodes[stream.inputNodeId];
-    auto outputNode = graphNodes[stream.outputNodeId];
+    auto stream = streams[index];
     
-    if (inputNode == nullptr || outputNode == nullptr) return;
+    stream->isDirty = false;
     
-    // InputOrOutput is swapped because the stream inputs from the output side of the input node
-    auto start = inputNode->component->getParameterPosition(InputOrOutput::Output, stream.inputParamId);
+    streamLayerDirty = true;
     
-    auto end = outputNode->component->getParameterPosition(InputOrOutput::Input, stream.outputParamId);
+    if (streamSelected && stream->streamId == selectedStreamId && stream->type == selectedStreamType)
+        selectedShadowDirty = true;
     
-    auto* streamEl = paintStreamInternal(g, start, end, stream.type);
+    auto producer = graphNodes[stream->producerNodeId];
+    auto consumer = graphNodes[stream->consumerNodeId];
     
-    streamEl->streamId = stream.selfId;
+    if (producer == nullptr || consumer == nullptr)
+    { // the editor's nodes haven't caught up with the graph yet
+        stream->path.reset(new juce::Path());
+        streamGrid.remove(index);
+        return;
+    }
+    
+    // InputOrOutput is swapped because the stream inputs from the output side of the input node
+    // worked out from the bounds rather than the components, since a node off screen has no component
+    auto start = GraphNode::getParameterPosition(producer->bounds, InputOrOutput::Output, stream->producerParamId);
+    auto end = GraphNode::getParameterPosition(consumer->bounds, InputOrOutput::Input, stream->consumerParamId);
+    
+    stream->path.reset(createStream(start, end));
+    
+    streamGrid.move(index, stream->path->getBounds());
 }
 
-void GraphAreaStreams::paint (juce::Graphics& g)
+void GraphAreaStreams::updateStreams()
 {
-    dataManager->activeInstance->prepareStreams();
-    streams.clear();
-
-    for (auto stream : dataManager->activeInstance->audioStreams)
+    if (streamsDirty)
     {
-        if (stream.inputNodeId == -1 || stream.outputNodeId == -1) break;
+        // the active instance has already been prepared, so its streams are packed and know their ids
+        streamsDirty = anyStreamDirty = false;
+        
+        streams.clear();
+        streamGrid.clear();
+        
+        for (auto& stream : dataManager->getActiveInstance()->audioStreams)
+        {
+            if (stream.inputNodeId == -1 || stream.outputNodeId == -1) break;
+            
+            addStream(stream);
+        }
+        
+        for (auto& stream : dataManager->getActiveInstance()->valueStreams)
+        {
+            if (stream.inputNodeId == -1 || stream.outputNodeId == -1) break;
+            
+            addStream(stream);
+        }
         
-        paintStream(g, stream);
+        return;
     }
     
-    for (auto stream : dataManager->activeInstance->valueStreams)
+    if (!anyStreamDirty) return;
+    
+    anyStreamDirty = false;
+    
+    for (int index = 0; index < streams.size(); index++)
     {
-        if (stream.inputNodeId == -1 || stream.outputNodeId == -1) break;
-        
-        paintStream(g, stream);
+        if (streams[index]->isDirty) updateStreamPath(index);
     }
+}
+
+void GraphAreaStreams::renderStreamLayer(float scale)
+{
+    streamLayerDirty = false;
+    streamLayerScale = scale;
     
-    if (streamSelected)
+    streamLayer = juce::Image(juce::Image::ARGB, juce::jmax(1, juce::roundToInt(getWidth() * scale)), juce::jmax(1, juce::roundToInt(getHeight() * scale)), true);
+    
+    juce::Graphics g(streamLayer);
+    g.addTransform(juce::AffineTransform::scale(scale));
+    g.addTransform(viewTransform);
+    
+    // only the streams that cross the screen, in the order they were made so overlaps don't shuffle as the view moves
+    streamGrid.query(getLocalBounds().toFloat().transformedBy(inverseViewTransform), gridResults);
+    gridResults.sort();
+    
+    for (int index : gridResults)
+        paintStreamPath(g, *streams[index]->path, streams[index]->type);
+    
+    if (!streamSelected) return;
+    
+    // the shadow is in graph space, so it's made at the zoomed resolution
+    const float shadowScale = scale * viewTransform.getScaleFactor();
+    
+    for (int index : gridResults)
     {
-        auto shadow = juce::DropShadow(juce::Colour(0xa0cccccc), 40, {0, 0});
-
-        for (auto stream : streams)
+        auto stream = streams[index];
+        
+        if (selectedStreamId != stream->streamId || selectedStreamType != stream->type) continue;
+        
+        if (selectedShadowDirty || selectedShadow.getWidth() != juce::roundToInt(selectedShadowBounds.getWidth() * shadowScale))
         {
-            if (selectedStreamId == stream->streamId && selectedStreamType == stream->type)
-            {
-                shadow.drawForPath(g, *stream->path);
-                break;
-            }
+            selectedShadowDirty = false;
+            selectedShadowBounds = stream->path->getBounds().expanded((float) selectedShadowRadius).getSmallestIntegerContainer();
+            
+            selectedShadow = juce::Image(juce::Image::ARGB, juce::jmax(1, juce::roundToInt(selectedShadowBounds.getWidth() * shadowScale)), juce::jmax(1, juce::roundToInt(selectedShadowBounds.getHeight() * shadowScale)), true);
+            
+            juce::Graphics shadowGraphics(selectedShadow);
+            shadowGraphics.addTransform(juce::AffineTransform::translation((float) -selectedShadowBounds.getX(), (float) -selectedShadowBounds.getY()).scaled(shadowScale));
+            
+            juce::DropShadow(juce::Colour(0xa0cccccc), selectedShadowRadius, {0, 0}).drawForPath(shadowGraphics, *stream->path);
         }
+        
+        g.drawImage(selectedShadow, selectedShadowBounds.toFloat());
+        break;
     }
+}
+
+void GraphAreaStreams::paint (juce::Graphics& g)
+{
+    updateStreams();
+    
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    
+    if (streamLayerDirty || scale != streamLayerScale || streamLayer.getWidth() != juce::roundToInt(getWidth() * scale) || streamLayer.getHeight() != juce::roundToInt(getHeight() * scale))
+        renderStreamLayer(scale);
+    
+    g.drawImage(streamLayer, getLocalBounds().toFloat());
     
     if (dragStreamNodeId != -1)
     {
-        auto s = paintStreamInternal(g, dragStreamOrigin, dragStreamEndpoint, dragStreamType, false);
+        std::unique_ptr<juce::Path> path (createStream(dragStreamOrigin, dragStreamEndpoint));
         
-        delete s;
+        g.addTransform(viewTransform);
+        paintStreamPath(g, *path, dragStreamType);
     }
 }
 
@@ -219,16 +338,9 @@ void GraphAreaStreams::resized()
 void GraphAreaStreams::mouseDown(const juce::MouseEvent &event)
 {
     // get clicked stream
-    Stream* stream;
-    for (auto s : streams) {
-        if (s->streamId != -1 && s->path->contains(event.getPosition().toFloat()))
-        {
-            stream = s;
-            break;
-        }
-    }
+    Stream* stream = getStreamAt(event.position.transformedBy(inverseViewTransform));
     
-    if (stream == nullptr) return;
+    if (stream == nullptr || stream->streamId == -1) return;
     
     // give to parent to handle
     handleSelectStream(stream->type, stream->streamId);
@@ -236,18 +348,15 @@ void GraphAreaStreams::mouseDown(const juce::MouseEvent &event)
 
 void GraphAreaStreams::mouseDoubleClick(const juce::MouseEvent &event)
 {
-    Stream* stream;
-    for (auto s : streams) {
-        if (s->path->contains(event.getPosition().toFloat()))
-        {
-            stream = s;
-            break;
-        }
-    }
+    Stream* stream = getStreamAt(event.position.transformedBy(inverseViewTransform));
+    
+    if (stream == nullptr) return;
+    
+    auto consumer = dataManager->getConsumer(dataManager->getActiveInstance(), stream->type, stream->streamId);
     
-    dataManager->startEditing();
-    dataManager->removeStream(stream->type, stream->streamId);
-    dataManager->finishEditing();
+    if (consumer.nodeId == -1) return;
+    
+    dataManager->perform(new Edit::Disconnect(stream->type, consumer));
     
     handleRemoveStream();
     
@@ -258,6 +367,7 @@ void GraphAreaStreams::mouseDoubleClick(const juce::MouseEvent &event)
 void GraphAreaStreams::selectStream()
 {
     streamSelected = false;
+    streamLayerDirty = selectedShadowDirty = true;
     
     repaint();
 }
@@ -267,6 +377,7 @@ void GraphAreaStreams::selectStream(ParameterType type, int streamId)
     streamSelected = true;
     selectedStreamId = streamId;
     selectedStreamType = type;
+    streamLayerDirty = selectedShadowDirty = true;
     
     repaint();
 }
@@ -276,11 +387,13 @@ void GraphAreaStreams::handleStartDragStream(int nodeId, InputOrOutput inputOrOu
     dragStreamNodeId = nodeId;
     dragStreamInputOrOutput = inputOrOutput;
     dragStreamParamId = paramId;
-    dragStreamType = graphNodes[nodeId]->component->getParameterType(dragStreamInputOrOutput, paramId);
+    
+    auto node = dataManager->getActiveInstance()->nodes[nodeId];
+    dragStreamType = inputOrOutput == InputOrOutput::Input ? node->inputParams[paramId].type : node->outputParams[paramId].type;
     
     // don't need to repaint yet, because the stream won't be going anywhere
     
-    dragStreamOrigin = graphNodes[nodeId]->component->getParameterPosition(inputOrOutput, paramId);
+    dragStreamOrigin = GraphNode::getParameterPosition(graphNodes[nodeId]->bounds, inputOrOutput, paramId);
 }
 
 void GraphAreaStreams::handleDragStreamEnd(juce::Point<float> position)
@@ -288,50 +401,32 @@ void GraphAreaStreams::handleDragStreamEnd(juce::Point<float> position)
     // check if mouse is over another parameter; if yes, connect the two, overriding and deleting any existing stream connected to the input side of the output node of the new stream if yk what i mean
     // if not, just nodeId = -1 and repaint so it clears the thingo. consider whether if side is input (as in dragging left to right) should it clear the stream? maybe? maybe not? who knows, i mean they can already do it anyway.
 
-    for (auto node : graphNodes)
+    // by the nodes' bounds and the pills' layout rather than their components, which are all in graph space like position
+    for (int nodeId = 0; nodeId < graphNodes.size(); nodeId++)
     {
-        if (!node->component->getBounds().contains(position.toInt())) continue;
+        auto bounds = graphNodes[nodeId]->bounds;
+        auto node = dataManager->getActiveInstance()->nodes[nodeId];
+        
+        if (!bounds.contains(position.toInt()) || node == nullptr) continue;
         
-        if (node->component->getBounds().getCentreX() > position.getX()) // check input params
+        if (bounds.getCentreX() > position.getX()) // check input params
         {
             if (dragStreamInputOrOutput == InputOrOutput::Input)
             { // wait nvm this can't work so we have to do the default which is clear the stream
                 goto endloop;
             }
             
-            for (auto param : node->component->getInputParams())
+            for (int paramId = 0; paramId < NUM_PARAMS && node->inputParams[paramId].isActive; paramId++)
             {
-                if (!param->component->getPillRect().contains(param->component->getLocalPoint(this, position.toInt()).toFloat())) continue;
+                if (!GraphNode__Parameter::getPillRect(GraphNode::getParameterBounds(bounds, InputOrOutput::Input, paramId), InputOrOutput::Input).contains(position)) continue;
                 
-                auto& paramData = dataManager->activeInstance->nodes[node->component->getNodeId()]->inputParams[param->component->getParamId()];
+                auto& paramData = node->inputParams[paramId];
                 
                 // ensure they are of the same type
                 if (paramData.type != dragStreamType) goto endloop;
                 
-                dataManager->startEditing();
-                
-                // first, remove any stream with the remove stream method that connects to the other one's input side
-                
-                auto currentStreamId = paramData.streamId;
-                
-                if (currentStreamId != -1)
-                {
-                    dataManager->removeStream(dragStreamType, currentStreamId);
-                }
-                
-                // then, find the next available streamid
-                int id = dataManager->inactiveInstance->getNextStreamId(dragStreamType);
-                
-                // then, just add to the output and set the input
-                if (!dataManager->inactiveInstance->nodes[dragStreamNodeId]->outputParams[dragStreamParamId].addStreamId(id)) 
-                {
-                    //TODO: handle error!!!!!!
-                    DBG("failed to add stream - too many streams on output parameter");
-                }
-                
-                dataManager->inactiveInstance->nodes[node->component->getNodeId()]->inputParams[param->component->getParamId()].streamId = id;
-                
-                dataManager->finishEditing();
+                // connecting replaces any stream already going into the input
+                dataManager->perform(new Edit::Connect(dragStreamType, {dragStreamNodeId, dragStreamParamId}, {nodeId, paramId}));
                 
 //                DBG("we've finished");
                                 
@@ -344,39 +439,16 @@ void GraphAreaStreams::handleDragStreamEnd(juce::Point<float> position)
                 goto endloop;
             }
             
-            for (auto param : node->component->getOutputParams())
+            for (int paramId = 0; paramId < NUM_PARAMS && node->outputParams[paramId].isActive; paramId++)
             {
-                if (!param->component->getPillRect().contains(param->component->getLocalPoint(this, position.toInt()).toFloat())) continue;
+                if (!GraphNode__Parameter::getPillRect(GraphNode::getParameterBounds(bounds, InputOrOutput::Output, paramId), InputOrOutput::Output).contains(position)) continue;
                 
-                auto& paramData = dataManager->activeInstance->nodes[node->component->getNodeId()]->outputParams[param->component->getParamId()];
+                auto& paramData = node->outputParams[paramId];
                 
                 // ensure they are of the same type
                 if (paramData.type != dragStreamType) goto endloop;
                 
-                dataManager->startEditing();
-                
-                // first, remove any stream with the remove stream method that connects to the other one's input side
-                
-                auto currentStreamId = dataManager->inactiveInstance->nodes[dragStreamNodeId]->inputParams[dragStreamParamId].streamId;
-                
-                if (currentStreamId != -1)
-                {
-                    dataManager->removeStream(dragStreamType, currentStreamId);
-                }
-                
-                // then, find the next available streamid
-                int id = dataManager->inactiveInstance->getNextStreamId(dragStreamType);
-                
-                // then, just add to the output and set the input
-                if (!dataManager->inactiveInstance->nodes[node->component->getNodeId()]->outputParams[param->component->getParamId()].addStreamId(id))
-                {
-                    //TODO: handle error!!!!!!
-                    DBG("failed to add stream - too many streams on output parameter");
-                }
-                
-                dataManager->inactiveInstance->nodes[dragStreamNodeId]->inputParams[dragStreamParamId].streamId = id;
-                
-                dataManager->finishEditing();
+                dataManager->perform(new Edit::Connect(dragStreamType, {nodeId, paramId}, {dragStreamNodeId, dragStreamParamId}));
                 
 //                DBG("we've finished");
                                 
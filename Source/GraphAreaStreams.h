@@ -14,6 +14,7 @@
 #include "GraphNode.h"
 #include "DataManager.h"
 #include "Common.h"
+#include "SpatialGrid.h"
 
 //==============================================================================
 /*
@@ -37,8 +38,13 @@ public:
     void selectStream(); // clears selection
     void selectStream(ParameterType type, int streamId);
     
+    void invalidateStreams(); // when the streams or the node components have changed, e.g. on realisation
+    void invalidateNode(int nodeId); // when a node has moved, so only its streams need new paths
+    
+    void setViewTransform(const juce::AffineTransform& transform); // from graph space, which the paths are made in, to this component
+    
     void handleStartDragStream(int nodeId, InputOrOutput inputOrOutuput, int paramId);
-    void handleDragStreamMove(juce::Point<float> position);
+    void handleDragStreamMove(juce::Point<float> position); // in graph space
     void handleDragStreamEnd(juce::Point<float> position);
     
     std::function<void(ParameterType type, int streamId)> handleSelectStream;
@@ -58,21 +64,55 @@ private:
         std::unique_ptr<juce::Path> path;
         int streamId;
         ParameterType type;
+        
+        int producerNodeId; // the node it comes out of
+        int producerParamId;
+        int consumerNodeId; // the node it goes into
+        int consumerParamId;
+        
+        bool isDirty = true; // an end has moved since the path was made
     };
     
     juce::Path* createStream(juce::Array<juce::Point<float>> anchorPoints);
-    void paintStream(juce::Graphics& g, Data::Stream stream);
-    Stream* paintStreamInternal(juce::Graphics& g, juce::Point<float> startPosition, juce::Point<float> endPosition, ParameterType type, bool addStream = true);
+    juce::Path* createStream(juce::Point<float> startPosition, juce::Point<float> endPosition);
+    void paintStreamPath(juce::Graphics& g, const juce::Path& path, ParameterType type);
     juce::Rectangle<float> getStreamRectangle(Direction direction, juce::Point<float> start, juce::Point<float> end, float thickness);
     
+    void updateStreams(); // remakes only what's been invalidated
+    void addStream(const Data::Stream& stream);
+    void updateStreamPath(int index);
+    Stream* getStreamAt(juce::Point<float> position); // in graph space
+    
+    juce::AffineTransform viewTransform;
+    juce::AffineTransform inverseViewTransform; // for mouse positions
+    
     juce::OwnedArray<Common::Node>& graphNodes;
     std::shared_ptr<DataManager> dataManager;
     
+    // the paths are kept between paints, and a grid of their bounds narrows down which ones a point could be in
     juce::OwnedArray<Stream> streams;
+    SpatialGrid streamGrid;
+    juce::Array<int> gridResults;
+    
+    bool streamsDirty = true;
+    bool anyStreamDirty = false;
+    
+    // every stream drawn into one image, remade only when a path or the selection changes; a stream being dragged out is drawn over it live
+    void renderStreamLayer(float scale);
+    juce::Image streamLayer;
+    float streamLayerScale = 0;
+    bool streamLayerDirty = true;
+    
+    // the selected stream's shadow is the slowest thing to draw, so it's kept as well, until the selection or its path changes
+    juce::Image selectedShadow;
+    juce::Rectangle<int> selectedShadowBounds;
+    bool selectedShadowDirty = true;
+    
+    static constexpr int selectedShadowRadius = 40;
     
     ParameterType selectedStreamType;
     int selectedStreamId;
-    bool streamSelected;
+    bool streamSelected = false;
     
     int dragStreamNodeId = -1;
     int dragStreamParamId;
@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "GraphNode.h"
+#include "EditHistory.h"
 
 
 const float GraphNode::cornerRadius = 10.0f;
@@ -21,7 +22,8 @@ GraphNode::GraphNode(std::shared_ptr<DataManager> d, int node, juce::Rectangle<f
 {
     dataManager = d;
     nodeId = node;
-    name = dataManager->activeInstance->nodes[nodeId]->friendlyName;
+    uid = dataManager->getActiveInstance()->nodes[nodeId]->uid;
+    name = dataManager->layout.getLabel(dataManager->getActiveInstance()->nodes[nodeId]);
     
     removeButton.onClick = [this] () {
         onRemove();
@@ -30,34 +32,97 @@ GraphNode::GraphNode(std::shared_ptr<DataManager> d, int node, juce::Rectangle<f
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
     
-    hasInputSide = dataManager->activeInstance->nodes[nodeId]->hasInputSide;
-    hasOutputSide = dataManager->activeInstance->nodes[nodeId]->hasOutputSide;
+    hasInputSide = dataManager->getActiveInstance()->nodes[nodeId]->hasInputSide;
+    hasOutputSide = dataManager->getActiveInstance()->nodes[nodeId]->hasOutputSide;
     
+    addParameters(dataManager->getActiveInstance()->nodes[nodeId]);
+    
+    if (!dataManager->getActiveInstance()->nodes[nodeId]->isGlobalLockedNode)
+        addAndMakeVisible(removeButton);
+}
+
+GraphNode::~GraphNode()
+{
+}
+
+void GraphNode::addParameters(Data::Node* node)
+{
     for (int paramId = 0; paramId < NUM_PARAMS; paramId++)
     {
-        if (!dataManager->activeInstance->nodes[nodeId]->inputParams[paramId].isActive) break;
+        if (!node->inputParams[paramId].isActive) break;
         
-        addParameter(dataManager->activeInstance->nodes[nodeId]->inputParams[paramId].type, paramId, dataManager->activeInstance->nodes[nodeId]->inputParams[paramId].friendlyName, InputOrOutput::Input);
+        addParameter(node->inputParams[paramId].type, paramId, node->inputParams[paramId].friendlyName, InputOrOutput::Input);
         
-        if (dataManager->activeInstance->nodes[nodeId]->inputParams[paramId].isConst)
+        if (node->inputParams[paramId].isConst)
         {
             inputParameters.getLast()->component->setIsConst(true);
-            inputParameters.getLast()->component->setConstValue(dataManager->activeInstance->nodes[nodeId]->inputParams[paramId].constValue);
+            inputParameters.getLast()->component->setConstValue(node->inputParams[paramId].constValue);
         }
     }
     
     for (int paramId = 0; paramId < NUM_PARAMS; paramId++)
     {
-        if (!dataManager->activeInstance->nodes[nodeId]->outputParams[paramId].isActive) break;
-        addParameter(dataManager->activeInstance->nodes[nodeId]->outputParams[paramId].type, paramId, dataManager->activeInstance->nodes[nodeId]->outputParams[paramId].friendlyName, InputOrOutput::Output);
+        if (!node->outputParams[paramId].isActive) break;
+        addParameter(node->outputParams[paramId].type, paramId, node->outputParams[paramId].friendlyName, InputOrOutput::Output);
     }
+}
+
+bool GraphNode::parametersMatch(Data::Node* node)
+{
+    int numInputs = 0;
+    int numOutputs = 0;
     
-    if (!dataManager->activeInstance->nodes[nodeId]->isGlobalLockedNode)
-        addAndMakeVisible(removeButton);
+    for (; numInputs < NUM_PARAMS && node->inputParams[numInputs].isActive; numInputs++)
+    {
+        if (numInputs >= inputParameters.size()) return false;
+        
+        auto component = inputParameters[numInputs]->component.get();
+        
+        if (component->paramType != node->inputParams[numInputs].type || component->paramName != node->inputParams[numInputs].friendlyName) return false;
+    }
+    
+    for (; numOutputs < NUM_PARAMS && node->outputParams[numOutputs].isActive; numOutputs++)
+    {
+        if (numOutputs >= outputParameters.size()) return false;
+        
+        auto component = outputParameters[numOutputs]->component.get();
+        
+        if (component->paramType != node->outputParams[numOutputs].type || component->paramName != node->outputParams[numOutputs].friendlyName) return false;
+    }
+    
+    return numInputs == inputParameters.size() && numOutputs == outputParameters.size();
 }
 
-GraphNode::~GraphNode()
+void GraphNode::update()
 {
+    auto node = dataManager->getActiveInstance()->nodes[nodeId];
+    
+    jassert(node != nullptr && node->uid == uid);
+    
+    name = dataManager->layout.getLabel(node);
+    
+    if (!parametersMatch(node))
+    {
+        inputParameters.clear();
+        outputParameters.clear();
+        
+        addParameters(node);
+        
+        resized();
+    } else
+    {
+        for (auto param : inputParameters)
+        {
+            auto& inputParam = node->inputParams[param->component->getParamId()];
+            
+            param->component->setIsConst(inputParam.isConst);
+            
+            if (inputParam.isConst)
+                param->component->setConstValue(inputParam.constValue);
+        }
+    }
+    
+    repaint();
 }
 
 void GraphNode::addParameter(ParameterType paramType, int paramId, const juce::String& name, InputOrOutput inputOrOutput)
@@ -68,20 +133,11 @@ void GraphNode::addParameter(ParameterType paramType, int paramId, const juce::S
     addAndMakeVisible(p->component.get());
     
     p->component->onConstValueChanged = [this, paramId] (float value) {
-        dataManager->startEditing();
-        
-        dataManager->inactiveInstance->nodes[nodeId]->inputParams[paramId].constValue = value;
-        
-        dataManager->finishEditing();
+        dataManager->perform(new Edit::SetConst(nodeId, paramId, dataManager->getActiveInstance()->nodes[nodeId]->inputParams[paramId].isConst, value));
     };
     
     p->component->onSetIsConst = [this, p, paramId] (bool isConst) {
-        dataManager->startEditing();
-        
-        dataManager->inactiveInstance->nodes[nodeId]->inputParams[paramId].isConst = isConst;
-        dataManager->inactiveInstance->nodes[nodeId]->inputParams[paramId].constValue = p->component->getConstValue();
-        
-        dataManager->finishEditing();
+        dataManager->perform(new Edit::SetConst(nodeId, paramId, isConst, p->component->getConstValue()));
     };
     
     p->component->onDragStart = [this, inputOrOutput, paramId] () {
@@ -108,28 +164,53 @@ void GraphNode::addParameter(ParameterType paramType, int paramId, const juce::S
     }
 }
 
-juce::Point<float> GraphNode::getParameterPosition(InputOrOutput side, int index)
+juce::Rectangle<int> GraphNode::getParameterBounds(juce::Rectangle<int> nodeBounds, InputOrOutput side, int index)
 {
-    std::unique_ptr<GraphNode__Parameter> component;
+    auto paramArea = nodeBounds.reduced(shadowSize);
     
-    if (side == InputOrOutput::Input) {
-        return inputParameters[index]->component->getLocalPoint(getParentComponent(), inputParameters[index]->component->getPillRect().getCentre() * -1) * -1;
-    }
-    else {
-        return outputParameters[index]->component->getLocalPoint(getParentComponent(), outputParameters[index]->component->getPillRect().getCentre() * -1) * -1;
-    }
+    if (side == InputOrOutput::Input)
+        paramArea.removeFromRight(paramArea.getWidth() / 2);
+    else
+        paramArea.removeFromLeft(paramArea.getWidth() / 2);
     
-//    return component->getLocalPoint(getParentComponent(), component->getPillRect().getCentre() * -1) * -1;
+    paramArea.removeFromTop(headerHeight + paramPadding);
+    paramArea.setHeight(paramHeight);
+    
+    return paramArea.translated(0, index * (paramHeight + paramPadding));
+}
+
+juce::Point<float> GraphNode::getParameterPosition(juce::Rectangle<int> nodeBounds, InputOrOutput side, int index)
+{
+    auto paramBounds = getParameterBounds(nodeBounds, side, index);
+    
+    return GraphNode__Parameter::getPillRect(paramBounds, side).getCentre();
 }
 
 void GraphNode::paint (juce::Graphics& g)
 {
-    /* This demo code just fills the component's background and
-       draws some placeholder text to get you started.
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    
+    if (bodyImageDirty || scale != bodyImageScale)
+        renderBodyImage(scale);
+    
+    g.drawImage(bodyImage, getLocalBounds().toFloat());
+    
+    g.setColour (juce::Colours::white);
+    g.setFont (juce::FontOptions (headerHeight * 0.5f));
+    g.drawText (name, headerBounds.reduced(10.0f, 5.0f),
+                juce::Justification::centredLeft, true);
+}
 
-       You should replace everything in this method with your own
-       drawing code..
-    */
+void GraphNode::renderBodyImage(float scale)
+{
+    bodyImageDirty = false;
+    bodyImageScale = scale;
+    
+    // at the display's own resolution, so drawing it back is 1:1
+    bodyImage = juce::Image(juce::Image::ARGB, juce::jmax(1, juce::roundToInt(getWidth() * scale)), juce::jmax(1, juce::roundToInt(getHeight() * scale)), true);
+    
+    juce::Graphics g(bodyImage);
+    g.addTransform(juce::AffineTransform::scale(scale));
     
     auto bounds = getLocalBounds().reduced(shadowSize);
 
@@ -154,15 +235,12 @@ void GraphNode::paint (juce::Graphics& g)
         
         g.fillPath(outputSide);
     }
-    
-    g.setColour (juce::Colours::white);
-    g.setFont (juce::FontOptions (headerHeight * 0.5f));
-    g.drawText (name, headerBounds.reduced(10.0f, 5.0f),
-                juce::Justification::centredLeft, true);
 }
 
 void GraphNode::resized()
 {
+    bodyImageDirty = true;
+    
     // Header
 
     headerBounds = getLocalBounds().reduced(shadowSize);
@@ -174,38 +252,38 @@ void GraphNode::resized()
     // Input Params
     if (hasInputSide)
     {
-        auto inputParamArea = getLocalBounds().reduced(shadowSize);
-        
-        inputParamArea.removeFromRight(inputParamArea.getWidth() / 2);
-        inputParamArea.removeFromTop(headerHeight + paramPadding);
-        inputParamArea.setHeight(paramHeight);
-        
-        for (auto param : inputParameters) {
-            param->component->setBounds(inputParamArea);
-            inputParamArea.translate(0, paramHeight + paramPadding);
-        }
+        for (int index = 0; index < inputParameters.size(); index++)
+            inputParameters[index]->component->setBounds(getParameterBounds(getLocalBounds(), InputOrOutput::Input, index));
     }
     
     // Output Params
     if (hasOutputSide)
     {
-        auto outputParamArea = getLocalBounds().reduced(shadowSize);
-        
-        outputParamArea.removeFromLeft(outputParamArea.getWidth() / 2);
-        outputParamArea.removeFromTop(headerHeight + paramPadding);
-        outputParamArea.setHeight(paramHeight);
-        
-        for (auto param : outputParameters) {
-            param->component->setBounds(outputParamArea);
-            outputParamArea.translate(0, paramHeight + paramPadding);
-        }
+        for (int index = 0; index < outputParameters.size(); index++)
+            outputParameters[index]->component->setBounds(getParameterBounds(getLocalBounds(), InputOrOutput::Output, index));
     }
 }
 
 float GraphNode::getIdealHeight() 
+{
+    return getIdealHeight(inputParameters.size(), outputParameters.size());
+}
+
+float GraphNode::getIdealHeight(int numInputs, int numOutputs)
 {
     // TODO: add anything else needed on node
-    return shadowSize * 2 + headerHeight + std::max(inputParameters.size(), outputParameters.size()) * (paramHeight + paramPadding) + paramPadding;
+    return shadowSize * 2 + headerHeight + std::max(numInputs, numOutputs) * (paramHeight + paramPadding) + paramPadding;
+}
+
+juce::Rectangle<int> GraphNode::getIdealBounds(Data::Node* node, juce::Point<float> position)
+{
+    int numInputs = 0;
+    int numOutputs = 0;
+    
+    while (numInputs < NUM_PARAMS && node->inputParams[numInputs].isActive) numInputs++;
+    while (numOutputs < NUM_PARAMS && node->outputParams[numOutputs].isActive) numOutputs++;
+    
+    return {(int) position.x, (int) position.y, node->hasInputSide && node->hasOutputSide ? 300 : 150, (int) getIdealHeight(numInputs, numOutputs)};
 }
 
 void GraphNode::mouseDown(const juce::MouseEvent &event) {
@@ -324,10 +402,9 @@ void GraphNode::mouseUp(const juce::MouseEvent &event)
     
     isBeingDragged = false;
     
-    dataManager->startEditing();
-    dataManager->inactiveInstance->nodes[nodeId]->position.setX(getX());
-    dataManager->inactiveInstance->nodes[nodeId]->position.setY(getY());
-    dataManager->finishEditing();
+    auto from = dataManager->layout.getPosition(uid);
+    
+    dataManager->perform(new Edit::MoveNode(uid, from, getPosition().toFloat()));
     
 //    onDataUpdate();
 }
@@ -413,16 +490,14 @@ void GraphNode__Parameter::paint (juce::Graphics& g)
     g.drawText(paramName, textRect, inputOrOutput == InputOrOutput::Input ? juce::Justification::centredLeft : juce::Justification::centredRight);
 }
 
-juce::Rectangle<float> GraphNode__Parameter::getPillRect()
+juce::Rectangle<float> GraphNode__Parameter::getPillRect(juce::Rectangle<int> bounds, InputOrOutput side)
 {
-    auto bounds = getLocalBounds();
-    
     float pillHeight = bounds.getHeight() - 2 * padVertical;
     float pillWidth = pillHeight * 1.5f;
     
     return juce::Rectangle<float>(
-        inputOrOutput == InputOrOutput::Input ? padSide : bounds.getWidth() - padSide - pillWidth,
-        padVertical,
+        side == InputOrOutput::Input ? bounds.getX() + padSide : bounds.getRight() - padSide - pillWidth,
+        bounds.getY() + padVertical,
         pillWidth,
         pillHeight
     );
@@ -450,13 +525,13 @@ void GraphNode__Parameter::mouseDoubleClick(const juce::MouseEvent &event)
 
 void GraphNode__Parameter::mouseDrag(const juce::MouseEvent &event)
 {
-    // i really don't know why i have to do this double negation but it works so im happy
-    onDrag(getLocalPoint(getParentComponent()->getParentComponent(), event.getPosition().toFloat() * -1) * -1);
+    // in graph space, which the node's own space is offset from by its position; the view's zoom and pan apply on top of both
+    onDrag(owner.getPosition().toFloat() + owner.getLocalPoint(this, event.position));
 }
 
 void GraphNode__Parameter::mouseUp(const juce::MouseEvent &event)
 {
-    onDragEnd(getLocalPoint(getParentComponent()->getParentComponent(), event.getPosition().toFloat() * -1) * -1);
+    onDragEnd(owner.getPosition().toFloat() + owner.getLocalPoint(this, event.position));
 }
 
 bool GraphNode__Parameter::hitTest(int x, int y)
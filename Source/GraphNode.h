@@ -41,7 +41,8 @@ public:
     std::function<void(juce::Point<float>)> onDrag;
     std::function<void(juce::Point<float>)> onDragEnd;
     
-    juce::Rectangle<float> getPillRect();
+    juce::Rectangle<float> getPillRect() {return getPillRect(getLocalBounds(), inputOrOutput);}
+    static juce::Rectangle<float> getPillRect(juce::Rectangle<int> bounds, InputOrOutput side); // in the same space as bounds
     
     void setIsConst(bool v) {isConst = v; constLabel.setVisible(isConst);}
     bool getIsConst() {return isConst;}
@@ -63,8 +64,8 @@ private:
     bool isConst = false;
     float constValue;
     
-    const float padSide = 7;
-    const float padVertical  = 3;
+    static constexpr float padSide = 7;
+    static constexpr float padVertical  = 3;
     
     int paramId;
     
@@ -119,17 +120,28 @@ public:
     std::function<void(int nodeId)> handleSelectNode;
 
     float getIdealHeight();
+    static float getIdealHeight(int numInputs, int numOutputs);
+    static juce::Rectangle<int> getIdealBounds(Data::Node* node, juce::Point<float> position); // where the node's component goes, in graph space, whether or not it has one
     void setNodeId(int n) {nodeId = n;}
     int getNodeId() {return nodeId;}
+    int getUid() {return uid;}
+    
+    void update(); // from the node at nodeId in the active instance; only rebuilds the parameters if they've changed
+    
+    bool getIsBeingDragged() {return isBeingDragged;}
     
     void addParameter(ParameterType, int, const juce::String&, InputOrOutput);
-    juce::Point<float> getParameterPosition(InputOrOutput side, int index);
+    
+    // the layout of the parameters, worked out from the node's bounds alone so nodes without a component can be laid out the same way
+    static juce::Rectangle<int> getParameterBounds(juce::Rectangle<int> nodeBounds, InputOrOutput side, int index);
+    static juce::Point<float> getParameterPosition(juce::Rectangle<int> nodeBounds, InputOrOutput side, int index); // the middle of its pill
+    
     ParameterType getParameterType(InputOrOutput side, int index);
     
     juce::OwnedArray<Parameter>& getInputParams() {return inputParameters;}
     juce::OwnedArray<Parameter>& getOutputParams() {return outputParameters;}
     
-    void setSelected(bool v) {isSelected = v;}
+    void setSelected(bool v) {if (v == isSelected) return; isSelected = v; bodyImageDirty = true; repaint();}
     
     bool hasInputSide = true;
     bool hasOutputSide = true;
@@ -139,8 +151,8 @@ public:
     static const float shadowSize;
 private:
     
-    const int paramHeight = 20;
-    const int paramPadding = 5;
+    static constexpr int paramHeight = 20;
+    static constexpr int paramPadding = 5;
     
     juce::ComponentDragger componentDragger;
     juce::Rectangle<int> headerBounds;
@@ -149,16 +161,26 @@ private:
     juce::String name;
     
     bool allowDrag;
-    bool isBeingDragged;
+    bool isBeingDragged = false;
     
     bool isSelected = false;
     
+    // the shadow and background, which only change with the size and selection; the name is drawn over it each time
+    void renderBodyImage(float scale);
+    juce::Image bodyImage;
+    float bodyImageScale = 0;
+    bool bodyImageDirty = true;
+    
     juce::OwnedArray<Parameter> inputParameters;
     juce::OwnedArray<Parameter> outputParameters;
     
     GraphNode__RemoveButton removeButton;
     
+    void addParameters(Data::Node* node);
+    bool parametersMatch(Data::Node* node);
+    
     int nodeId;
+    int uid;
     std::shared_ptr<DataManager> dataManager;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphNode)
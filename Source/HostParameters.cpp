@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+  
+    HostParameters.cpp
+    Created: 19 Oct 2026 2:41:06pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include "HostParameters.h"
+
+HostParameters::HostParameters()
+{
+    for (int slot = 0; slot < NUM_INPUT_STREAMS; slot++)
+        inputValues[slot] = 0;
+    
+    for (int slot = 0; slot < NUM_OUTPUT_STREAMS; slot++)
+    {
+        pendingOutputs[slot] = NAN;
+        publishedOutputs[slot] = 0;
+        samplesSincePublished[slot] = 0;
+        outputsForHost[slot] = NAN;
+    }
+}
+
+HostParameters::~HostParameters()
+{
+    stopTimer();
+}
+
+void HostParameters::addTo(juce::AudioProcessor& processor)
+{
+    for (int slot = 0; slot < NUM_INPUT_STREAMS; slot++)
+    {
+        auto id = "input" + juce::String(slot + 1);
+        auto name = "Input " + juce::String(slot + 1);
+        
+        inputParameters[slot] = new juce::AudioParameterFloat(juce::ParameterID(id, 1), name, 0.0f, 1.0f, 0.0f);
+        
+        processor.addParameter(inputParameters[slot]);
+    }
+    
+    for (int slot = 0; slot < NUM_OUTPUT_STREAMS; slot++)
+    {
+        auto id = "output" + juce::String(slot + 1);
+        auto name = "Output " + juce::String(slot + 1);
+        
+        outputParameters[slot] = new juce::AudioParameterFloat(juce::ParameterID(id, 1), name, 0.0f, 1.0f, 0.0f);
+        
+        processor.addParameter(outputParameters[slot]);
+    }
+}
+
+void HostParameters::prepareToPlay(double sampleRate)
+{
+    minSamplesBetweenOutputs = juce::jmax(1, (int) (sampleRate / maxOutputRateHz));
+    
+    for (int slot = 0; slot < NUM_INPUT_STREAMS; slot++)
+    {
+        inputSmoothers[slot].reset(sampleRate, inputRampSeconds);
+        
+        if (inputParameters[slot] != nullptr)
+            inputSmoothers[slot].setCurrentAndTargetValue(inputParameters[slot]->get());
+        
+        inputValues[slot] = inputSmoothers[slot].getCurrentValue();
+    }
+    
+    startTimerHz((int) maxOutputRateHz);
+}
+
+void HostParameters::releaseResources()
+{
+    stopTimer();
+    timerCallback(); // so the last values chosen still reach the host
+}
+
+void HostParameters::updateInputs(int numSamples)
+{
+    for (int slot = 0; slot < NUM_INPUT_STREAMS; slot++)
+    {
+        if (inputParameters[slot] == nullptr) continue;
+        
+        inputSmoothers[slot].setTargetValue(inputParameters[slot]->get());
+        inputValues[slot] = inputSmoothers[slot].skip(numSamples);
+    }
+}
+
+float HostParameters::getInputValue(int slot)
+{
+    if (slot < 0 || slot >= NUM_INPUT_STREAMS) return 0;
+    
+    return inputValues[slot];
+}
+
+void HostParameters::setOutputValue(int slot, float normalisedValue)
+{
+    if (slot < 0 || slot >= NUM_OUTPUT_STREAMS || std::isnan(normalisedValue)) return;
+    
+    pendingOutputs[slot] = juce::jlimit(0.0f, 1.0f, normalisedValue);
+}
+
+void HostParameters::publishOutputs(int numSamples)
+{
+    for (int slot = 0; slot < NUM_OUTPUT_STREAMS; slot++)
+    {
+        samplesSincePublished[slot] = juce::jmin(samplesSincePublished[slot] + numSamples, minSamplesBetweenOutputs);
+        
+        const float value = pendingOutputs[slot];
+        
+        if (std::isnan(value) || outputParameters[slot] == nullptr) continue;
+        
+        if (samplesSincePublished[slot] < minSamplesBetweenOutputs) continue; // stays pending until the interval is up
+        
+        pendingOutputs[slot] = NAN;
+        
+        const float quantised = std::round(value * outputSteps) / outputSteps;
+        
+        if (quantised == publishedOutputs[slot]) continue;
+        
+        publishedOutputs[slot] = quantised;
+        samplesSincePublished[slot] = 0;
+        
+        outputsForHost[slot].store(quantised, std::memory_order_release); // replaces anything the timer hasn't taken yet
+    }
+}
+
+void HostParameters::timerCallback()
+{
+    for (int slot = 0; slot < NUM_OUTPUT_STREAMS; slot++)
+    {
+        const float value = outputsForHost[slot].exchange(NAN, std::memory_order_acquire);
+        
+        if (!std::isnan(value) && outputParameters[slot] != nullptr)
+            outputParameters[slot]->setValueNotifyingHost(value);
+    }
+}
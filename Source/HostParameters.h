@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+  
+    HostParameters.h
+    Created: 19 Oct 2026 2:41:06pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DataManager.h"
+
+/**
+ The plugin parameters that the graph exchanges with the host, owned by the processor.
+ Parameter input nodes read the input parameters as value streams. Each input is read once per block with an atomic load (AudioParameterFloat keeps its value in a std::atomic<float>), then ramped towards with a SmoothedValue across the block's samples, so automating an input never needs the graph to be edited.
+ Parameter output nodes only write a pending value while the graph is evaluated; publishOutputs() then quantises it to outputSteps and passes it on at most once every minimum interval per parameter, and only if the quantised value has changed, so that a smoothly varying stream doesn't turn into a flood of automation writes.
+ The interval is counted in samples rather than wall clock time, so an offline bounce picks the same values that real time playback would.
+ The audio thread never calls into the host itself, since some hosts lock or allocate in setValueNotifyingHost: the chosen values go through one atomic per parameter, and a timer on the message thread hands them over. The timer only runs between prepareToPlay and releaseResources.
+ */
+class HostParameters : private juce::Timer
+{
+public:
+    HostParameters();
+    ~HostParameters() override;
+    
+    void addTo(juce::AudioProcessor& processor); // creates the parameters, which the processor then owns
+    void prepareToPlay(double sampleRate);
+    void releaseResources();
+    
+    void updateInputs(int numSamples); // audio thread, before evaluation
+    float getInputValue(int slot); // the smoothed value at the end of the block
+    
+    void setOutputValue(int slot, float normalisedValue); // audio thread, during evaluation
+    void publishOutputs(int numSamples); // audio thread, after evaluation
+    
+    static constexpr float outputSteps = 1024.0f; // finer changes than this aren't worth telling the host about
+    static constexpr double maxOutputRateHz = 50.0; // per parameter, and the rate the timer hands values to the host
+    static constexpr double inputRampSeconds = 0.02;
+
+private:
+    juce::AudioParameterFloat* inputParameters[NUM_INPUT_STREAMS] = {};
+    juce::SmoothedValue<float> inputSmoothers[NUM_INPUT_STREAMS];
+    float inputValues[NUM_INPUT_STREAMS];
+    
+    juce::AudioParameterFloat* outputParameters[NUM_OUTPUT_STREAMS] = {};
+    
+    float pendingOutputs[NUM_OUTPUT_STREAMS]; // NAN if there's nothing new
+    float publishedOutputs[NUM_OUTPUT_STREAMS]; // quantised
+    int samplesSincePublished[NUM_OUTPUT_STREAMS];
+    
+    std::atomic<float> outputsForHost[NUM_OUTPUT_STREAMS]; // NAN once the timer has taken it
+    
+    void timerCallback() override;
+    
+    int minSamplesBetweenOutputs = 441;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HostParameters)
+};
@@ -13,9 +13,10 @@
 #include "InspectorPanel.h"
 #include "DataManager.h"
 #include "AnalysisGraphContent.h"
+#include "EditHistory.h"
 
 //==============================================================================
-InspectorPanel::InspectorPanel(std::shared_ptr<DataManager> d) : valueStreamGraph(d)
+InspectorPanel::InspectorPanel(std::shared_ptr<DataManager> d) : inputParamsList(d, InputOrOutput::Input), outputParamsList(d, InputOrOutput::Output), valueStreamGraph(d), audioStreamProbe(d), bindingTimer([this] () {refreshBindings();})
 {
     dataManager = d;
     
@@ -24,16 +25,28 @@ InspectorPanel::InspectorPanel(std::shared_ptr<DataManager> d) : valueStreamGrap
 
     addAndMakeVisible(header);
     addChildComponent(valueStreamGraph);
+    addChildComponent(audioStreamProbe);
+    addChildComponent(rampChoice);
+    addChildComponent(midiTypeChoice);
     addChildComponent(mathsNodeTextBox);
+    addChildComponent(inputParamsList);
+    addChildComponent(outputParamsList);
     
     mathsNodeTextBox.setName("Expression (ExprTK):");
     
+    rampChoice.setName("Audio rate ramp");
+    rampChoice.setOptions({"Linear", "Decibel linear", "One pole"}); // in the order of RampShape
+    
+    midiTypeChoice.setName("Message");
+    midiTypeChoice.setOptions({"CC", "14-bit CC", "Pitch bend"}); // in the order of MidiOutputNode::MessageType
+    
     header.setText("Nothing Selected");
     
 }
 
 InspectorPanel::~InspectorPanel()
 {
+    bindingTimer.stopTimer();
 }
 
 void InspectorPanel::paint (juce::Graphics& g)
@@ -43,14 +56,38 @@ void InspectorPanel::paint (juce::Graphics& g)
 
 void InspectorPanel::reset()
 {
-    groups.clear();
-    individualParams.clear();
+    bindingTimer.stopTimer();
+    
+    // everything goes back in the pools rather than being deleted, so the next selection doesn't allocate
+    for (auto group : groups)
+    {
+        group->clearParams();
+        group->setVisible(false);
+    }
+    
+    for (int i = 0; i < numParamsInUse; i++)
+    {
+        paramPool[i]->unbind();
+        paramPool[i]->setVisible(false);
+    }
+    
+    groups.clearQuick();
+    individualParams.clearQuick();
+    numParamsInUse = 0;
+    
     header.setText("");
     valueStreamGraph.setVisible(false);
+    audioStreamProbe.setVisible(false); // which stops the probe
+    rampChoice.setVisible(false);
+    midiTypeChoice.setVisible(false);
     mathsNodeTextBox.setVisible(false);
     
-    inputParamsList.reset();
-    outputParamsList.reset();
+    rampChoice.bind = nullptr;
+    midiTypeChoice.bind = nullptr;
+    mathsNodeTextBox.bind = nullptr;
+    
+    inputParamsList.setVisible(false);
+    outputParamsList.setVisible(false);
 }
 
 void InspectorPanel::resized()
@@ -88,13 +125,35 @@ void InspectorPanel::resized()
     
     if (streamSelected && selectedStreamType == ParameterType::Value)
     {
+        float h = rampChoice.getIdealHeight();
+        
+        rampChoice.setBounds(b.withY(currHeight).withHeight(h));
+        
+        currHeight += h + padding;
+        
         valueStreamGraph.setBounds(b.withY(currHeight).withHeight(100));
         valueStreamGraph.setSelection(selectedStreamType, selectedStreamId);
         
         currHeight += 100 + padding;
     }
     
-    if (nodeSelected && dataManager->activeInstance->nodes[selectedNodeId]->getType() == NodeType::Maths)
+    if (streamSelected && selectedStreamType == ParameterType::Audio)
+    {
+        audioStreamProbe.setBounds(b.withY(currHeight).withHeight(200));
+        
+        currHeight += 200 + padding;
+    }
+    
+    if (midiTypeChoice.isVisible())
+    {
+        float h = midiTypeChoice.getIdealHeight();
+        
+        midiTypeChoice.setBounds(b.withY(currHeight).withHeight(h));
+        
+        currHeight += h + padding;
+    }
+    
+    if (mathsNodeTextBox.isVisible())
     {
         float h = mathsNodeTextBox.getIdealHeight();
         
@@ -103,18 +162,18 @@ void InspectorPanel::resized()
         currHeight += h + padding;
     }
     
-    if (inputParamsList != nullptr) {
-        float idealHeight =inputParamsList->getIdealHeight();
+    if (inputParamsList.isVisible()) {
+        float idealHeight =inputParamsList.getIdealHeight();
         
-        inputParamsList->setBounds(b.withY(currHeight).withHeight(idealHeight));
+        inputParamsList.setBounds(b.withY(currHeight).withHeight(idealHeight));
         
         currHeight += idealHeight + padding;
     }
     
-    if (outputParamsList != nullptr) {
-        float idealHeight =outputParamsList->getIdealHeight();
+    if (outputParamsList.isVisible()) {
+        float idealHeight =outputParamsList.getIdealHeight();
         
-        outputParamsList->setBounds(b.withY(currHeight).withHeight(idealHeight));
+        outputParamsList.setBounds(b.withY(currHeight).withHeight(idealHeight));
         
         currHeight += idealHeight + padding;
     }
@@ -128,6 +187,9 @@ void InspectorPanel::pubtest()
 void InspectorPanel::setSelection()
 {
     reset();
+    
+    nodeSelected = false;
+    streamSelected = false;
 }
 
 void InspectorPanel::setSelection(ParameterType type, int streamId)
@@ -145,38 +207,39 @@ void InspectorPanel::setSelection(ParameterType type, int streamId)
     
     if (type == ParameterType::Value)
     {
-        auto envelope = new InspectorPanel__Group();
-        envelope->setName("Envelope");
+        auto envelope = makeGroup("Envelope");
         
-        auto attack = new InspectorPanel__Param();
-        attack->setName("Attack time");
-        attack->setValue(juce::String(dataManager->activeInstance->valueStreams[streamId].envelope.getMsAttack()));
-        attack->setSuffix("ms");
+        auto attack = makeParam("Attack time", "ms");
+        attack->bind = [this, streamId] () {return juce::String(dataManager->getActiveInstance()->valueStreams[streamId].getMsAttack());};
         attack->handleInput = [this, streamId] (const juce::String& newVal) {
-            dataManager->startEditing();
-            dataManager->inactiveInstance->valueStreams[streamId].envelope.setMsAttack(newVal.getFloatValue());
-            dataManager->finishEditing();
+            dataManager->perform(new Edit::SetEnvelope(streamId, Edit::SetEnvelope::Time::Attack, newVal.getFloatValue()));
         };
         
-        auto release = new InspectorPanel__Param();
-        release->setName("Release time");
-        release->setSuffix("ms");
-        release->setValue(juce::String(dataManager->activeInstance->valueStreams[streamId].envelope.getMsRelease()));
+        auto release = makeParam("Release time", "ms");
+        release->bind = [this, streamId] () {return juce::String(dataManager->getActiveInstance()->valueStreams[streamId].getMsRelease());};
         release->handleInput = [this, streamId] (const juce::String& newVal) {
-            dataManager->startEditing();
-            
-            dataManager->inactiveInstance->valueStreams[streamId].envelope.setMsRelease(newVal.getFloatValue());
-            dataManager->finishEditing();
+            dataManager->perform(new Edit::SetEnvelope(streamId, Edit::SetEnvelope::Time::Release, newVal.getFloatValue()));
         };
         
         envelope->addParam(attack);
         envelope->addParam(release);
         
-        addGroup(envelope);
+        rampChoice.setVisible(true);
+        rampChoice.bind = [this, streamId] () {return (int) dataManager->getActiveInstance()->valueStreams[streamId].rampShape;};
+        rampChoice.handleInput = [this, streamId] (int newIndex) {
+            dataManager->perform(new Edit::SetRampShape(streamId, (RampShape) newIndex));
+        };
         
         valueStreamGraph.setVisible(true);
         valueStreamGraph.setSelection(type, streamId);
     }
+    else
+    {
+        audioStreamProbe.setSelection(streamId);
+        audioStreamProbe.setVisible(true);
+    }
+    
+    startBindings();
     
     resized();
 }
@@ -189,42 +252,124 @@ void InspectorPanel::setSelection(int nodeId)
     streamSelected = false;
     selectedNodeId = nodeId;
     
-    auto node = dataManager->activeInstance->nodes[nodeId];
+    auto node = dataManager->getActiveInstance()->nodes[nodeId];
     
     if (node == nullptr) return;
     
-    header.setText(node->friendlyName);
+    selectedNodeUid = node->uid;
     
-    auto position = new InspectorPanel__Group(); // TODO: doesn't yet update shown values with dataManager, idk how to do this though and i cant be bothered rn
-    position->setName("Position");
+    auto position = makeGroup("Position");
     
-    auto xPos = new InspectorPanel__Param();
-    xPos->setName("x");
-    xPos->setValue(juce::String(node->position.getX()));
-    xPos->handleInput = [this, nodeId] (const juce::String& newVal) {
-        dataManager->startEditing();
-        dataManager->inactiveInstance->nodes[nodeId]->position.setX(newVal.getFloatValue());
-        dataManager->finishEditing();
+    const int uid = node->uid;
+    
+    auto xPos = makeParam("x");
+    xPos->bind = [this, uid] () {return juce::String(dataManager->layout.getPosition(uid).getX());};
+    xPos->handleInput = [this, uid] (const juce::String& newVal) {
+        auto from = dataManager->layout.getPosition(uid);
+        dataManager->perform(new Edit::MoveNode(uid, from, from.withX(newVal.getFloatValue())));
     };
     
-    auto yPos = new InspectorPanel__Param();
-    yPos->setName("y");
-    yPos->setValue(juce::String(node->position.getY()));
-    yPos->handleInput = [this, nodeId] (const juce::String& newVal) {
-        dataManager->startEditing();
-        dataManager->inactiveInstance->nodes[nodeId]->position.setY(newVal.getFloatValue());
-        dataManager->finishEditing();
+    auto yPos = makeParam("y");
+    yPos->bind = [this, uid] () {return juce::String(dataManager->layout.getPosition(uid).getY());};
+    yPos->handleInput = [this, uid] (const juce::String& newVal) {
+        auto from = dataManager->layout.getPosition(uid);
+        dataManager->perform(new Edit::MoveNode(uid, from, from.withY(newVal.getFloatValue())));
     };
     
     position->addParam(xPos);
     position->addParam(yPos);
     
-    addGroup(position);
+    if (node->getType() == NodeType::ParameterOutput || node->getType() == NodeType::ParameterInput)
+    {
+        const bool isOutput = node->getType() == NodeType::ParameterOutput;
+        const int numSlots = isOutput ? NUM_OUTPUT_STREAMS : NUM_INPUT_STREAMS;
+        
+        auto hostParameter = makeGroup("Host Parameter");
+        
+        auto slot = makeParam(isOutput ? "Output" : "Input", "of " + juce::String(numSlots));
+        slot->bind = [this, nodeId, isOutput] () {
+            auto node = dataManager->getActiveInstance()->nodes[nodeId];
+            return juce::String((isOutput ? ((Data::ParameterOutputNode*)node)->slot : ((Data::ParameterInputNode*)node)->slot) + 1);
+        };
+        slot->handleInput = [this, nodeId, numSlots] (const juce::String& newVal) {
+            dataManager->startEditing();
+            
+            auto node = dataManager->inactiveInstance->nodes[nodeId];
+            const int newSlot = juce::jlimit(0, numSlots - 1, newVal.getIntValue() - 1);
+            
+            if (node != nullptr && node->getType() == NodeType::ParameterOutput)
+                ((Data::ParameterOutputNode*)node)->slot = newSlot;
+            else if (node != nullptr && node->getType() == NodeType::ParameterInput)
+                ((Data::ParameterInputNode*)node)->slot = newSlot;
+            
+            dataManager->finishEditing();
+        };
+        
+        hostParameter->addParam(slot);
+    }
+    
+    if (node->getType() == NodeType::MidiOutput)
+    {
+        // reads from the active copy of this node, which refreshBindings has already checked is still this node
+        auto midiNode = [this, nodeId] () {return (Data::MidiOutputNode*) dataManager->getActiveInstance()->nodes[nodeId];};
+        
+        // applies an edit to the inactive copy of this node, if it is still a midi output node
+        auto editMidiNode = [this, nodeId] (std::function<void(Data::MidiOutputNode*)> f) {
+            dataManager->startEditing();
+            
+            auto node = dataManager->inactiveInstance->nodes[nodeId];
+            
+            if (node != nullptr && node->getType() == NodeType::MidiOutput)
+                f((Data::MidiOutputNode*)node);
+            
+            dataManager->finishEditing();
+        };
+        
+        midiTypeChoice.setVisible(true);
+        midiTypeChoice.bind = [midiNode] () {return (int) midiNode()->messageType;};
+        midiTypeChoice.handleInput = [editMidiNode] (int newIndex) {
+            editMidiNode([newIndex] (Data::MidiOutputNode* n) {
+                n->messageType = (Data::MidiOutputNode::MessageType) newIndex;
+                n->controller = juce::jmin(n->controller, n->getMaxController());
+            });
+        };
+        
+        auto midi = makeGroup("MIDI");
+        
+        auto channel = makeParam("Channel");
+        channel->bind = [midiNode] () {return juce::String(midiNode()->channel);};
+        channel->handleInput = [editMidiNode] (const juce::String& newVal) {
+            editMidiNode([newVal] (Data::MidiOutputNode* n) {n->channel = juce::jlimit(1, 16, newVal.getIntValue());});
+        };
+        
+        auto controller = makeParam("Controller");
+        controller->bind = [midiNode] () {return juce::String(midiNode()->controller);};
+        controller->handleInput = [editMidiNode] (const juce::String& newVal) {
+            editMidiNode([newVal] (Data::MidiOutputNode* n) {n->controller = juce::jlimit(0, n->getMaxController(), newVal.getIntValue());});
+        };
+        
+        auto threshold = makeParam("Threshold", "steps");
+        threshold->bind = [midiNode] () {return juce::String(midiNode()->thresholdSteps);};
+        threshold->handleInput = [editMidiNode] (const juce::String& newVal) {
+            editMidiNode([newVal] (Data::MidiOutputNode* n) {n->thresholdSteps = juce::jmax(1, newVal.getIntValue());});
+        };
+        
+        auto interval = makeParam("Min interval", "ms");
+        interval->bind = [midiNode] () {return juce::String(midiNode()->minIntervalMs);};
+        interval->handleInput = [editMidiNode] (const juce::String& newVal) {
+            editMidiNode([newVal] (Data::MidiOutputNode* n) {n->minIntervalMs = juce::jmax(0.0f, newVal.getFloatValue());});
+        };
+        
+        midi->addParam(channel);
+        midi->addParam(controller);
+        midi->addParam(threshold);
+        midi->addParam(interval);
+    }
     
     if (node->getType() == NodeType::Maths)
     {
         mathsNodeTextBox.setVisible(true);
-        mathsNodeTextBox.setValue(((Data::MathsNode*)node)->expression_string);
+        mathsNodeTextBox.bind = [this, nodeId] () {return ((Data::MathsNode*) dataManager->getActiveInstance()->nodes[nodeId])->expression_string;};
         
         mathsNodeTextBox.handleInput = [this, nodeId] (const juce::String& newVal) {
             dataManager->startEditing();
@@ -244,15 +389,79 @@ void InspectorPanel::setSelection(int nodeId)
         };
     }
     
-    inputParamsList.reset(new InspectorPanel__ParamsList(dataManager, selectedNodeId, InputOrOutput::Input));
-    outputParamsList.reset(new InspectorPanel__ParamsList(dataManager, selectedNodeId, InputOrOutput::Output));
+    inputParamsList.setNode(selectedNodeId);
+    outputParamsList.setNode(selectedNodeId);
+    
+    inputParamsList.setVisible(true);
+    outputParamsList.setVisible(true);
     
-    addAndMakeVisible(*inputParamsList);
-    addAndMakeVisible(*outputParamsList);
+    startBindings();
     
     resized();
 }
 
+void InspectorPanel::startBindings()
+{
+    refreshBindings(); // so nothing is shown stale until the first tick
+    
+    bindingTimer.startTimer(bindingInterval);
+}
+
+void InspectorPanel::refreshBindings()
+{
+    // every bound field is read here at most once per tick, however often the data behind it changes
+    if (nodeSelected)
+    {
+        auto node = dataManager->getActiveInstance()->nodes[selectedNodeId];
+        
+        if (node == nullptr || node->uid != selectedNodeUid) return; // deleted, and the editor will move the selection on
+        
+        header.setText(dataManager->layout.getLabel(node));
+        
+        const bool inputsChanged = inputParamsList.refresh();
+        const bool outputsChanged = outputParamsList.refresh();
+        
+        if (inputsChanged || outputsChanged) resized();
+    }
+    
+    for (int i = 0; i < numParamsInUse; i++)
+        paramPool[i]->refresh();
+    
+    rampChoice.refresh();
+    midiTypeChoice.refresh();
+    mathsNodeTextBox.refresh();
+}
+
+InspectorPanel__Group* InspectorPanel::makeGroup(juce::String name)
+{
+    const int index = groups.size();
+    
+    if (index == groupPool.size())
+        groupPool.add(new InspectorPanel__Group());
+    
+    auto group = groupPool[index];
+    
+    group->setName(name);
+    
+    addGroup(group);
+    
+    return group;
+}
+
+InspectorPanel__Param* InspectorPanel::makeParam(juce::String name, juce::String suffix)
+{
+    if (numParamsInUse == paramPool.size())
+        paramPool.add(new InspectorPanel__Param());
+    
+    auto param = paramPool[numParamsInUse++];
+    
+    param->setName(name);
+    param->setSuffix(suffix);
+    param->setVisible(true);
+    
+    return param;
+}
+
 void InspectorPanel::addGroup(InspectorPanel__Group *group)
 {
     addAndMakeVisible(group);
@@ -350,6 +559,8 @@ void InspectorPanel__Param::setSuffix(juce::String suffix_)
     suffix = suffix_;
     
     suffixLabel.setText(suffix, juce::dontSendNotification);
+    
+    resized(); // the field moves over to make room for it, even if a pooled param keeps its bounds
 }
 
 void InspectorPanel__Param::setValue(juce::String value)
@@ -357,6 +568,84 @@ void InspectorPanel__Param::setValue(juce::String value)
     fieldLabel.setText(value, juce::dontSendNotification);
 }
 
+void InspectorPanel__Param::refresh()
+{
+    if (bind == nullptr || fieldLabel.isBeingEdited()) return; // don't pull the text out from under the user
+    
+    setValue(bind()); // the label ignores text it already has, so an unchanged value doesn't repaint
+}
+
+void InspectorPanel__Param::unbind()
+{
+    bind = nullptr;
+    handleInput = [] (const juce::String&) {};
+}
+
+
+
+InspectorPanel__Choice::InspectorPanel__Choice() : font(juce::FontOptions(textHeight))
+{
+    addAndMakeVisible(nameLabel);
+    addAndMakeVisible(comboBox);
+    
+    nameLabel.setFont(font);
+    
+    comboBox.onChange = [this] ()
+    {
+        if (handleInput != nullptr)
+            handleInput(comboBox.getSelectedItemIndex());
+    };
+}
+
+InspectorPanel__Choice::~InspectorPanel__Choice()
+{
+}
+
+void InspectorPanel__Choice::paint (juce::Graphics& g)
+{
+}
+
+void InspectorPanel__Choice::resized()
+{
+    auto b = getLocalBounds();
+    
+    const float fieldWidth = 110;
+    
+    comboBox.setBounds(b.removeFromRight(fieldWidth));
+    
+    nameLabel.setBounds(b.withTrimmedRight(horizontalPadding));
+}
+
+float InspectorPanel__Choice::getIdealHeight()
+{
+    return 20;
+}
+
+void InspectorPanel__Choice::setName(juce::String name_)
+{
+    name = name_;
+    
+    nameLabel.setText(name, juce::dontSendNotification);
+}
+
+void InspectorPanel__Choice::setOptions(const juce::StringArray& options)
+{
+    comboBox.clear(juce::dontSendNotification);
+    comboBox.addItemList(options, 1);
+}
+
+void InspectorPanel__Choice::setSelectedIndex(int index)
+{
+    comboBox.setSelectedItemIndex(index, juce::dontSendNotification);
+}
+
+void InspectorPanel__Choice::refresh()
+{
+    if (bind == nullptr || comboBox.isPopupActive()) return;
+    
+    setSelectedIndex(bind());
+}
+
 
 
 InspectorPanel__TextBox::InspectorPanel__TextBox() : font(juce::FontOptions(textHeight))
@@ -410,6 +699,15 @@ void InspectorPanel__TextBox::setValue(juce::String value)
     textEditor.setText(value);
 }
 
+void InspectorPanel__TextBox::refresh()
+{
+    if (bind == nullptr || textEditor.hasKeyboardFocus(true)) return; // only written back on focus lost, so it is being edited
+    
+    auto value = bind();
+    
+    if (value != textEditor.getText()) setValue(value);
+}
+
 
 InspectorPanel__Header::InspectorPanel__Header()
 {
@@ -527,53 +825,56 @@ void InspectorPanel__Group::addParam(InspectorPanel__Param *param)
     params.add(param);
 }
 
+void InspectorPanel__Group::clearParams()
+{
+    for (auto param : params)
+        removeChildComponent(param);
+    
+    params.clearQuick();
+}
+
 
 
 
-InspectorPanel__ParamsList::InspectorPanel__ParamsList(std::shared_ptr<DataManager> d, int nodeId_, InputOrOutput side) : paramTable(d, nodeId_, side), font(juce::FontOptions(textHeight))
+InspectorPanel__ParamsList::InspectorPanel__ParamsList(std::shared_ptr<DataManager> d, InputOrOutput side_) : paramTable(d, -1, side_), font(juce::FontOptions(textHeight))
 {
     dataManager = d;
+    side = side_;
     
     setName(side == InputOrOutput::Input ? "Input Parameters" : "Output Parameters");
     addAndMakeVisible(nameLabel);
     
-    nodeId = nodeId_;
-    
     addAndMakeVisible(paramTable);
     
-    hasAddButton = (side == InputOrOutput::Input && dataManager->activeInstance->nodes[nodeId]->canAddInputParam())
-                    || (side == InputOrOutput::Output && dataManager->activeInstance->nodes[nodeId]->canAddOutputParam());
+    addChildComponent(addParamButton);
+    addParamButton.setButtonText("Add Parameter");
     
-    if (hasAddButton)
-    {
-        addAndMakeVisible(addParamButton);
-        addParamButton.setButtonText("Add Parameter");
+    addParamButton.onClick = [this] () {
+        // assume its a value param, because that's all that makes sense really
         
-        addParamButton.onClick = [this, side] () {
-            // assume its a value param, because that's all that makes sense really
-            
-            dataManager->startEditing();
-            
-            int id = dataManager->inactiveInstance->nodes[nodeId]->nextAvailableParamId(side);
-            
-            if (id == -1)
-            {
-                //TODO: don't fail silently please
-                dataManager->finishEditing();
-                return;
-            }
-            
-            Data::Parameter& param = side == InputOrOutput::Input ? (Data::Parameter&)dataManager->inactiveInstance->nodes[nodeId]->inputParams[id] : (Data::Parameter&)dataManager->inactiveInstance->nodes[nodeId]->outputParams[id];
-            
-            param.type = ParameterType::Value;
-            param.name = "input" + juce::String(id + 1);
-            param.friendlyName = "Input " + juce::String(id + 1);
-            param.isActive = true;
-            
+        dataManager->startEditing();
+        
+        int id = dataManager->inactiveInstance->nodes[nodeId]->nextAvailableParamId(side);
+        
+        if (id == -1)
+        {
+            //TODO: don't fail silently please
             dataManager->finishEditing();
-            
-        };
-    }
+            return;
+        }
+        
+        Data::Parameter& param = side == InputOrOutput::Input ? (Data::Parameter&)dataManager->inactiveInstance->nodes[nodeId]->inputParams[id] : (Data::Parameter&)dataManager->inactiveInstance->nodes[nodeId]->outputParams[id];
+        
+        param.type = ParameterType::Value;
+        param.name = "input" + juce::String(id + 1);
+        param.friendlyName = "Input " + juce::String(id + 1);
+        param.isActive = true;
+        
+        dataManager->finishEditing();
+        
+        dataManager->clearHistory(); // saved nodes don't know about the new parameter
+        
+    };
     
     nameLabel.setFont(juce::Font(juce::FontOptions(textHeight, juce::Font::FontStyleFlags::bold)));
 }
@@ -604,6 +905,31 @@ float InspectorPanel__ParamsList::getIdealHeight()
     return (textHeight + 5) + paramTable.getIdealHeight() + (hasAddButton ? 5 + buttonHeight : 0); // TODO: add button
 }
 
+void InspectorPanel__ParamsList::setNode(int nodeId_)
+{
+    nodeId = nodeId_;
+    
+    paramTable.setNode(nodeId);
+    numRows = paramTable.getNumRows();
+    
+    hasAddButton = (side == InputOrOutput::Input && dataManager->getActiveInstance()->nodes[nodeId]->canAddInputParam())
+                    || (side == InputOrOutput::Output && dataManager->getActiveInstance()->nodes[nodeId]->canAddOutputParam());
+    
+    addParamButton.setVisible(hasAddButton);
+}
+
+bool InspectorPanel__ParamsList::refresh()
+{
+    const int newNumRows = paramTable.getNumRows();
+    
+    if (newNumRows == numRows) return false;
+    
+    numRows = newNumRows;
+    paramTable.setNode(nodeId); // which updates the table's rows
+    
+    return true;
+}
+
 void InspectorPanel__ParamsList::setName(juce::String name_)
 {
     name = name_;
@@ -14,6 +14,7 @@
 #include "DataManager.h"
 #include "Common.h"
 #include "AnalysisGraphContent.h"
+#include "AudioProbeContent.h"
 #include "ParamTable.h"
 
 class InspectorPanel__Param  : public juce::Component
@@ -36,6 +37,10 @@ public:
     
     void setValue(juce::String value);
     
+    std::function<juce::String()> bind; // read by the inspector at display rate
+    void refresh();
+    void unbind(); // before going back into the pool
+    
     float getIdealHeight();
     
     const float textHeight = 15;
@@ -71,6 +76,9 @@ public:
     
     void setValue(juce::String value);
     
+    std::function<juce::String()> bind;
+    void refresh();
+    
     void setNumLines(int v);
     int getNumLines() {return numLines;};
     
@@ -93,6 +101,43 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InspectorPanel__TextBox)
 };
 
+class InspectorPanel__Choice  : public juce::Component
+{
+public:
+    InspectorPanel__Choice();
+    ~InspectorPanel__Choice() override;
+    
+    void paint (juce::Graphics&) override;
+    void resized() override;
+    
+    std::function<void(int newIndex)> handleInput;
+    
+    void setName(juce::String name_);
+    juce::String getName() {return name;};
+    
+    void setOptions(const juce::StringArray& options);
+    void setSelectedIndex(int index);
+    
+    std::function<int()> bind;
+    void refresh();
+    
+    float getIdealHeight();
+    
+    const float textHeight = 15;
+
+private:
+    juce::Label nameLabel;
+    juce::ComboBox comboBox;
+    
+    juce::String name;
+    
+    juce::Font font;
+    
+    const float horizontalPadding = 3;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InspectorPanel__Choice)
+};
+
 class InspectorPanel__Group  : public juce::Component
 {
 public:
@@ -108,12 +153,13 @@ public:
     float getIdealHeight();
     
     void addParam(InspectorPanel__Param* param);
+    void clearParams();
 
     const float textHeight = 15;
     const float paramIndent = 20;
     const float padding = 5;
 private:
-    juce::OwnedArray<InspectorPanel__Param> params;
+    juce::Array<InspectorPanel__Param*> params; // owned by the inspector's pool
     juce::Label label;
     juce::String name;
     
@@ -144,7 +190,7 @@ private:
 class InspectorPanel__ParamsList  : public juce::Component
 {
 public:
-    InspectorPanel__ParamsList(std::shared_ptr<DataManager> d, int nodeId_, InputOrOutput side);
+    InspectorPanel__ParamsList(std::shared_ptr<DataManager> d, InputOrOutput side_);
     ~InspectorPanel__ParamsList() override;
 
     void paint (juce::Graphics&) override;
@@ -160,6 +206,9 @@ public:
     
     float getIdealHeight();
     
+    void setNode(int nodeId_);
+    bool refresh(); // true if the number of rows changed, so the inspector needs laying out again
+    
     const float textHeight = 15;
     const float buttonHeight = 20;
 
@@ -168,9 +217,11 @@ private:
     ParamTable_Model paramTable;
     juce::TextButton addParamButton;
     std::shared_ptr<DataManager> dataManager;
-    int nodeId;
+    int nodeId = -1;
+    InputOrOutput side;
+    int numRows = 0;
     
-    bool hasAddButton;
+    bool hasAddButton = false;
     
     juce::String name;
     
@@ -200,26 +251,47 @@ public:
     void setSelection(int nodeId);
     
 private:
-    bool streamSelected;
+    bool streamSelected = false;
     ParameterType selectedStreamType;
     int selectedStreamId;
     
-    bool nodeSelected;
+    bool nodeSelected = false;
     int selectedNodeId;
+    int selectedNodeUid;
     
     InspectorPanel__Header header;
-    juce::OwnedArray<InspectorPanel__Group> groups;
-    juce::OwnedArray<InspectorPanel__Param> individualParams;
-    std::unique_ptr<InspectorPanel__ParamsList> inputParamsList;
-    std::unique_ptr<InspectorPanel__ParamsList> outputParamsList;
+    
+    // groups and params are taken from these pools on selection and handed back on reset, never deleted
+    juce::OwnedArray<InspectorPanel__Group> groupPool;
+    juce::OwnedArray<InspectorPanel__Param> paramPool;
+    int numParamsInUse = 0;
+    
+    juce::Array<InspectorPanel__Group*> groups;
+    juce::Array<InspectorPanel__Param*> individualParams;
+    InspectorPanel__ParamsList inputParamsList;
+    InspectorPanel__ParamsList outputParamsList;
     AnalysisGraphContent valueStreamGraph;
+    AudioProbeContent audioStreamProbe;
+    InspectorPanel__Choice rampChoice;
+    InspectorPanel__Choice midiTypeChoice;
     InspectorPanel__TextBox mathsNodeTextBox;
     
+    InspectorPanel__Group* makeGroup(juce::String name);
+    InspectorPanel__Param* makeParam(juce::String name, juce::String suffix = "");
+    
     void addGroup(InspectorPanel__Group* group);
     void addParam(InspectorPanel__Param* param);
     
     void reset();
     
+    // the shown values follow the data by polling every bound field on one timer, so however fast the
+    // engine or the edits change things, the inspector does at most one pass per tick
+    void startBindings();
+    void refreshBindings();
+    juce::TimedCallback bindingTimer;
+    
+    const int bindingInterval = 33; // about 30Hz
+    
     std::shared_ptr<DataManager> dataManager;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InspectorPanel)
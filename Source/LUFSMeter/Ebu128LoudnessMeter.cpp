@@ -194,6 +194,14 @@ void Ebu128LoudnessMeter::prepareToPlay (double sampleRate,
     reset();
 }
 
+void Ebu128LoudnessMeter::setChannelWeighting (const vector<double>& weights)
+{
+    jassert (weights.size() == channelWeighting.size());
+    
+    if (weights.size() == channelWeighting.size())
+        channelWeighting = weights;
+}
+
 void Ebu128LoudnessMeter::processBlock (const juce::AudioSampleBuffer& buffer)
 {
     // Copy the buffer, such that all upcoming calculations won't affect
@@ -86,6 +86,13 @@ public:
                         int estimatedSamplesPerBlock, 
                         int expectedRequestRate);
     
+    /** Replaces the default channel weighting, which assumes the surround
+        channels are channels 3 and 4 (L, R, C, Ls, Rs). Takes one weight per
+        channel, with 0 for channels to leave out such as the LFE; call it after
+        prepareToPlay.
+     */
+    void setChannelWeighting (const vector<double>& weights);
+    
     void processBlock (const juce::AudioSampleBuffer& buffer);
     
     float getShortTermLoudness() const;
@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+  
+    LayoutModel.cpp
+    Created: 20 Oct 2026 9:14:52am
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include "LayoutModel.h"
+#include "DataManager.h"
+
+juce::Point<float> LayoutModel::getPosition(int uid)
+{
+    const juce::ScopedLock scopedLock(lock);
+    
+    auto found = layouts.find(uid);
+    
+    return found == layouts.end() ? juce::Point<float>() : found->second.position;
+}
+
+juce::String LayoutModel::getLabel(Data::Node* node)
+{
+    const juce::ScopedLock scopedLock(lock);
+    
+    auto found = layouts.find(node->uid);
+    
+    if (found == layouts.end() || found->second.label.isEmpty()) return node->friendlyName;
+    
+    return found->second.label;
+}
+
+void LayoutModel::setPosition(int uid, juce::Point<float> position)
+{
+    {
+        const juce::ScopedLock scopedLock(lock);
+        layouts[uid].position = position;
+    }
+    
+    onChanged(uid);
+}
+
+void LayoutModel::setLabel(int uid, const juce::String& label)
+{
+    {
+        const juce::ScopedLock scopedLock(lock);
+        layouts[uid].label = label;
+    }
+    
+    onChanged(uid);
+}
+
+LayoutModel::NodeLayout LayoutModel::getLayout(int uid)
+{
+    const juce::ScopedLock scopedLock(lock);
+    
+    auto found = layouts.find(uid);
+    
+    return found == layouts.end() ? NodeLayout() : found->second;
+}
+
+void LayoutModel::setLayout(int uid, const NodeLayout& layout)
+{
+    {
+        const juce::ScopedLock scopedLock(lock);
+        layouts[uid] = layout;
+    }
+    
+    onChanged(uid);
+}
+
+void LayoutModel::retain(const juce::Array<int>& uids)
+{
+    const juce::ScopedLock scopedLock(lock);
+    
+    for (auto it = layouts.begin(); it != layouts.end();)
+    {
+        if (uids.contains(it->first)) ++it;
+        else it = layouts.erase(it);
+    }
+}
+
+void LayoutModel::serialise(Data::Node* node, juce::XmlElement* nodeElement)
+{
+    const auto layout = getLayout(node->uid); // not layouts[], which would make an entry for a node that's already been removed
+    
+    auto positionElement = new juce::XmlElement("position");
+    
+    auto positionXElement = new juce::XmlElement("x");
+    auto positionYElement = new juce::XmlElement("y");
+    positionXElement->addTextElement(juce::String(layout.position.getX()));
+    positionYElement->addTextElement(juce::String(layout.position.getY()));
+    
+    positionElement->addChildElement(positionXElement);
+    positionElement->addChildElement(positionYElement);
+    
+    nodeElement->addChildElement(positionElement);
+    
+    if (layout.label.isEmpty()) return;
+    
+    if (auto friendlyNameElement = nodeElement->getChildByName("friendlyName"))
+    {
+        friendlyNameElement->deleteAllChildElements();
+        friendlyNameElement->addTextElement(layout.label);
+    }
+}
+
+void LayoutModel::deserialise(Data::Node* node, juce::XmlElement* nodeElement)
+{
+    NodeLayout layout;
+    
+    if (auto positionElement = nodeElement->getChildByName("position"))
+    {
+        layout.position.setX(positionElement->getChildElementAllSubText("x", "0").getFloatValue());
+        layout.position.setY(positionElement->getChildElementAllSubText("y", "0").getFloatValue());
+    }
+    
+    // the node always takes its type's name, so anything else saved was a label
+    auto savedName = nodeElement->getChildElementAllSubText("friendlyName", {});
+    
+    if (savedName != node->friendlyName)
+        layout.label = savedName;
+    
+    const juce::ScopedLock scopedLock(lock);
+    layouts[node->uid] = layout;
+}
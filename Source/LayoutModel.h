@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+  
+    LayoutModel.h
+    Created: 20 Oct 2026 9:14:52am
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <unordered_map>
+
+namespace Data { class Node; }
+
+/**
+ Where each node sits on the canvas and what it's labelled, kept apart from the DataInstances since neither has any effect on the audio.
+ Editing it never copies or swaps an instance, so moving a node doesn't disturb the meters or anything else the audio thread is carrying between blocks.
+ Keyed by node uid rather than id, so nothing needs bumping when nodes before one are removed. A removed node's entry is kept until neither instance has the node, so it's still drawn where it was until the removal is realised; the removal's undo command keeps a copy to put back.
+ The audio thread never reads it; the lock is only for hosts that save state from another thread.
+ */
+class LayoutModel
+{
+public:
+    struct NodeLayout
+    {
+        juce::Point<float> position;
+        juce::String label;
+    };
+    
+    juce::Point<float> getPosition(int uid); // (0, 0) for a node that's never been placed
+    juce::String getLabel(Data::Node* node); // the node's own name unless it's been relabelled
+    
+    void setPosition(int uid, juce::Point<float> position);
+    void setLabel(int uid, const juce::String& label); // an empty label goes back to the node's own name
+    
+    NodeLayout getLayout(int uid);
+    void setLayout(int uid, const NodeLayout& layout);
+    void retain(const juce::Array<int>& uids); // erases every other node's entry, without notifying, since none of them are shown
+    
+    // the same elements a node has always been saved with, so old sessions load as they did
+    void serialise(Data::Node* node, juce::XmlElement* nodeElement);
+    void deserialise(Data::Node* node, juce::XmlElement* nodeElement);
+    
+    std::function<void(int uid)> onChanged = [] (int) {}; // message thread
+    
+private:
+    std::unordered_map<int, NodeLayout> layouts;
+    juce::CriticalSection lock;
+};
@@ -11,6 +11,7 @@
 #include <JuceHeader.h>
 #include "NodeLibraryPanel.h"
 #include "DataManager.h"
+#include "EditHistory.h"
 
 //==============================================================================
 NodeLibraryPanel::NodeLibraryPanel(std::shared_ptr<DataManager> d) : dataManager(d)
@@ -55,8 +56,21 @@ NodeLibraryPanel::NodeLibraryPanel(std::shared_ptr<DataManager> d) : dataManager
                 
                 // initialise parameters
                 node->addParameter(InputOrOutput::Input, ParameterType::Audio, "In");
+                node->addParameter(InputOrOutput::Input, ParameterType::Value, "Channel A");
+                node->addParameter(InputOrOutput::Input, ParameterType::Value, "Channel B");
                 node->addParameter(InputOrOutput::Output, ParameterType::Value, "Correlation");
                 
+                nodes.add(node);
+                break;
+            case NodeType::Width:
+                node = new NodeLibraryNode(Data::WidthNode::defaults.name, Data::WidthNode::defaults.hasInputSide, Data::WidthNode::defaults.hasOutputSide);
+                
+                // initialise parameters
+                node->addParameter(InputOrOutput::Input, ParameterType::Audio, "In");
+                node->addParameter(InputOrOutput::Input, ParameterType::Value, "Channel A");
+                node->addParameter(InputOrOutput::Input, ParameterType::Value, "Channel B");
+                node->addParameter(InputOrOutput::Output, ParameterType::Value, "Width");
+                
                 nodes.add(node);
                 break;
             case NodeType::Loudness:
@@ -77,6 +91,57 @@ NodeLibraryPanel::NodeLibraryPanel(std::shared_ptr<DataManager> d) : dataManager
                 node->addParameter(InputOrOutput::Input, ParameterType::Value, "Input 1");
                 node->addParameter(InputOrOutput::Output, ParameterType::Value, "Out");
                 
+                nodes.add(node);
+                break;
+            case NodeType::BandEnergy:
+                node = new NodeLibraryNode(Data::BandEnergyNode::defaults.name, Data::BandEnergyNode::defaults.hasInputSide, Data::BandEnergyNode::defaults.hasOutputSide);
+                
+                // initialise parameters
+                node->addParameter(InputOrOutput::Input, ParameterType::Audio, "In");
+                node->addParameter(InputOrOutput::Input, ParameterType::Value, "Low Hz");
+                node->addParameter(InputOrOutput::Input, ParameterType::Value, "High Hz");
+                node->addParameter(InputOrOutput::Output, ParameterType::Value, "dbFS");
+                
+                nodes.add(node);
+                break;
+            case NodeType::SpectralFeatures:
+                node = new NodeLibraryNode(Data::SpectralFeaturesNode::defaults.name, Data::SpectralFeaturesNode::defaults.hasInputSide, Data::SpectralFeaturesNode::defaults.hasOutputSide);
+                
+                // initialise parameters
+                node->addParameter(InputOrOutput::Input, ParameterType::Audio, "In");
+                node->addParameter(InputOrOutput::Output, ParameterType::Value, "Centroid");
+                node->addParameter(InputOrOutput::Output, ParameterType::Value, "Flux");
+                node->addParameter(InputOrOutput::Output, ParameterType::Value, "Rolloff");
+                node->addParameter(InputOrOutput::Output, ParameterType::Value, "Flatness");
+                
+                nodes.add(node);
+                break;
+            case NodeType::ParameterOutput:
+                node = new NodeLibraryNode(Data::ParameterOutputNode::defaults.name, Data::ParameterOutputNode::defaults.hasInputSide, Data::ParameterOutputNode::defaults.hasOutputSide);
+                
+                // initialise parameters
+                node->addParameter(InputOrOutput::Input, ParameterType::Value, "Value");
+                node->addParameter(InputOrOutput::Input, ParameterType::Value, "Min");
+                node->addParameter(InputOrOutput::Input, ParameterType::Value, "Max");
+                
+                nodes.add(node);
+                break;
+            case NodeType::ParameterInput:
+                node = new NodeLibraryNode(Data::ParameterInputNode::defaults.name, Data::ParameterInputNode::defaults.hasInputSide, Data::ParameterInputNode::defaults.hasOutputSide);
+                
+                // initialise parameters
+                node->addParameter(InputOrOutput::Output, ParameterType::Value, "Value");
+                
+                nodes.add(node);
+                break;
+            case NodeType::MidiOutput:
+                node = new NodeLibraryNode(Data::MidiOutputNode::defaults.name, Data::MidiOutputNode::defaults.hasInputSide, Data::MidiOutputNode::defaults.hasOutputSide);
+                
+                // initialise parameters
+                node->addParameter(InputOrOutput::Input, ParameterType::Value, "Value");
+                node->addParameter(InputOrOutput::Input, ParameterType::Value, "Min");
+                node->addParameter(InputOrOutput::Input, ParameterType::Value, "Max");
+                
                 nodes.add(node);
                 break;
         }
@@ -86,12 +151,7 @@ NodeLibraryPanel::NodeLibraryPanel(std::shared_ptr<DataManager> d) : dataManager
             
             if (getParentComponent()->getParentComponent()->getBounds().contains(p.toInt())) return;
             
-            dataManager->startEditing();
-            
-            int id = dataManager->inactiveInstance->getNextNodeId();
-            dataManager->addNode(id, type, p);
-            
-            dataManager->finishEditing();
+            dataManager->perform(new Edit::AddNode(type, toGraphSpace(p)));
             
 //            dataManager->registerOneTimeRealisationListener(onNodeAdded);
             
@@ -26,6 +26,7 @@ public:
     void resized() override;
     
     std::function<void()> onNodeAdded;
+    std::function<juce::Point<float>(juce::Point<float>)> toGraphSpace = [] (juce::Point<float> p) {return p;}; // for where a node is dropped, since the canvas can be zoomed and panned
 private:
     juce::OwnedArray<NodeLibraryNode> nodes;
     std::shared_ptr<DataManager> dataManager;
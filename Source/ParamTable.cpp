@@ -31,8 +31,18 @@ ParamTable_Model::~ParamTable_Model()
     table.setModel(nullptr);
 }
 
+void ParamTable_Model::setNode(int nodeId)
+{
+    selectedNodeId = nodeId;
+    
+    table.updateContent();
+    table.repaint();
+}
+
 int ParamTable_Model::getNumRows()
 {
+    if (selectedNodeId < 0 || dataManager->getActiveInstance()->nodes[selectedNodeId] == nullptr) return 0; // e.g. pooled before anything is selected
+    
     for (int i = 0; i < NUM_PARAMS; i++)
     {
         if (!getParameter(i).isActive) return i;
@@ -44,9 +54,9 @@ int ParamTable_Model::getNumRows()
 Data::Parameter& ParamTable_Model::getParameter(int index)
 {
     if (side == InputOrOutput::Input)
-        return dataManager->activeInstance->nodes[selectedNodeId]->inputParams[index];
+        return dataManager->getActiveInstance()->nodes[selectedNodeId]->inputParams[index];
     
-    return dataManager->activeInstance->nodes[selectedNodeId]->outputParams[index];
+    return dataManager->getActiveInstance()->nodes[selectedNodeId]->outputParams[index];
 }
 
 float ParamTable_Model::getIdealHeight()
@@ -185,6 +195,8 @@ void ParamTable_Model::handleInput(int row)
     
     dataManager->finishEditing();
     
+    dataManager->clearHistory(); // the parameters after row have been renumbered
+    
     dataManager->registerOneTimeRealisationListener([this] () { // FIXME: this doesn't actually update the table cells
         table.updateContent();
         table.repaint();
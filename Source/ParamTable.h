@@ -20,6 +20,8 @@ public:
     ParamTable_Model(std::shared_ptr<DataManager> d, int, InputOrOutput);
     ~ParamTable_Model() override;
     
+    void setNode(int nodeId);
+    
     int getNumRows() override;
     void paintRowBackground(juce::Graphics &, int rowNumber, int width, int height, bool rowIsSelected) override;
     void paintCell(juce::Graphics &, int rowNumber, int columnId, int width, int height, bool rowIsSelected) override;
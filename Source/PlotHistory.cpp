@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+  
+    PlotHistory.cpp
+    Created: 19 Oct 2026 10:05:51pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include "PlotHistory.h"
+
+PlotHistory::PlotHistory(int capacity_) : capacity(capacity_)
+{
+    jassert(capacity > 0);
+    
+    values.allocate((size_t) capacity, true);
+}
+
+void PlotHistory::clear()
+{
+    writeIndex = 0;
+    numStored = 0;
+}
+
+void PlotHistory::push(float value)
+{
+    values[writeIndex] = value;
+    
+    writeIndex = (writeIndex + 1) % capacity;
+    numStored = juce::jmin(numStored + 1, capacity);
+}
+
+void PlotHistory::push(const float* newValues, int numValues)
+{
+    // only the last capacity values can be kept anyway
+    if (numValues > capacity)
+    {
+        newValues += numValues - capacity;
+        numValues = capacity;
+    }
+    
+    const int numToEnd = juce::jmin(numValues, capacity - writeIndex);
+    
+    juce::FloatVectorOperations::copy(values + writeIndex, newValues, numToEnd);
+    juce::FloatVectorOperations::copy(values.get(), newValues + numToEnd, numValues - numToEnd);
+    
+    writeIndex = (writeIndex + numValues) % capacity;
+    numStored = juce::jmin(numStored + numValues, capacity);
+}
+
+float PlotHistory::getLatest()
+{
+    if (numStored == 0) return 0.0f;
+    
+    return values[(writeIndex + capacity - 1) % capacity];
+}
+
+int PlotHistory::getColumns(int numValues, int numColumns, juce::Range<float>* columns)
+{
+    numValues = juce::jmin(numValues, capacity);
+    
+    const int available = juce::jmin(numStored, numValues);
+    
+    if (available == 0 || numColumns <= 0) return 0;
+    
+    const double valuesPerColumn = (double) numValues / numColumns;
+    const int first = (writeIndex + capacity - available) % capacity; // the oldest value shown
+    
+    int column = 0;
+    
+    for (; column < numColumns; column++)
+    {
+        const int from = (int) (column * valuesPerColumn);
+        
+        if (from >= available) break;
+        
+        const int to = juce::jlimit(from + 1, available, (int) ((column + 1) * valuesPerColumn));
+        
+        float low = values[(first + from) % capacity];
+        float high = low;
+        
+        for (int i = from + 1; i < to; i++)
+        {
+            const float value = values[(first + i) % capacity];
+            
+            low = juce::jmin(low, value);
+            high = juce::jmax(high, value);
+        }
+        
+        columns[column] = {low, high};
+    }
+    
+    return column;
+}
@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+  
+    PlotHistory.h
+    Created: 19 Oct 2026 10:05:51pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ A fixed-size ring of the most recent values of something being plotted, so a plot can run for hours without its memory or paint time growing.
+ Plots read it back as the min and max of each pixel column, so drawing costs the same however many values each column covers, and short peaks still show up when there are more values than pixels.
+ Message thread only.
+ */
+class PlotHistory
+{
+public:
+    PlotHistory(int capacity_);
+    
+    void clear();
+    
+    void push(float value);
+    void push(const float* newValues, int numValues);
+    
+    int getNumValues() {return numStored;}
+    int getCapacity() {return capacity;}
+    float getLatest(); // 0 if empty
+    
+    /** The ranges of the most recent numValues values, split evenly into numColumns, oldest first.
+        While the history holds fewer than numValues, only the columns it reaches are filled, so a plot grows from the left until it's full.
+        Returns the number of columns filled.
+     */
+    int getColumns(int numValues, int numColumns, juce::Range<float>* columns);
+    
+private:
+    juce::HeapBlock<float> values;
+    int capacity;
+    int writeIndex = 0;
+    int numStored = 0;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlotHistory)
+};
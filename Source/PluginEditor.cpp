@@ -11,19 +11,25 @@
 #include "SideMenuHeader.h"
 #include "DataManager.h"
 #include "SideMenu.h"
+#include "EditHistory.h"
 
 //==============================================================================
 FXGraphAudioProcessorEditor::FXGraphAudioProcessorEditor (FXGraphAudioProcessor& p, std::shared_ptr<DataManager> d)
-: AudioProcessorEditor (&p), audioProcessor (p), m_sideMenu(d), m_graphAreaStreams(graphNodes, d)
+: AudioProcessorEditor (&p), audioProcessor (p), m_sideMenu(d), m_graphAreaStreams(graphNodes, d), m_graphAreaNodeContainer(graphNodes, d)
 {
     dataManager = d;
     
     std::function<void()> a = [this] () {
-        resetNodes();
+        reconcileNodes();
     };
     
     dataManager->registerRealisationListener(a);
     
+    // moves and labels don't go through the instances, so they're heard about here rather than on realisation
+    dataManager->layout.onChanged = [this] (int uid) {
+        updateNodeLayout(uid);
+    };
+    
     addAndMakeVisible(m_graphAreaNodeContainer);
     resetNodes();
     
@@ -37,7 +43,11 @@ FXGraphAudioProcessorEditor::FXGraphAudioProcessorEditor (FXGraphAudioProcessor&
     };
     
     m_sideMenu.onNodeAdded = [this] () {
-        resetNodes();
+        reconcileNodes();
+    };
+    
+    m_sideMenu.getNodeLibrary()->toGraphSpace = [this] (juce::Point<float> p) {
+        return p.transformedBy(getViewTransform().inverted());
     };
     
     addAndMakeVisible(m_sideMenu);
@@ -47,6 +57,9 @@ FXGraphAudioProcessorEditor::FXGraphAudioProcessorEditor (FXGraphAudioProcessor&
     // editor's size to whatever you need it to be.
     setSize (1000, 600);
     
+    setWantsKeyboardFocus(true);
+    setOpaque(true); // the background covers everything
+    
     // set look and feel
     
     getLookAndFeel().setColour(juce::ResizableWindow::backgroundColourId, juce::Colour(0xff2E2F38));
@@ -55,23 +68,178 @@ FXGraphAudioProcessorEditor::FXGraphAudioProcessorEditor (FXGraphAudioProcessor&
 
 FXGraphAudioProcessorEditor::~FXGraphAudioProcessorEditor()
 {
+    // the DataManager outlives the editor, so nothing of this can be left for it to call
+    dataManager->removeRealisationListener();
+    dataManager->layout.onChanged = [] (int) {};
+}
+
+bool FXGraphAudioProcessorEditor::keyPressed(const juce::KeyPress& key)
+{
+    const auto modifiers = key.getModifiers();
+    
+    if (!modifiers.isAnyModifierKeyDown())
+    {
+        juce::Point<float> direction;
+        
+        if (key.isKeyCode(juce::KeyPress::leftKey)) direction = {1, 0};
+        else if (key.isKeyCode(juce::KeyPress::rightKey)) direction = {-1, 0};
+        else if (key.isKeyCode(juce::KeyPress::upKey)) direction = {0, 1};
+        else if (key.isKeyCode(juce::KeyPress::downKey)) direction = {0, -1};
+        else return false;
+        
+        setView(zoom, pan + direction * keyPanStep);
+        return true;
+    }
+    
+    if (!modifiers.isCommandDown() || modifiers.isAltDown()) return false;
+    
+    const auto centre = getLocalBounds().toFloat().withTrimmedLeft(m_sideMenu.getShown() ? 300.0f : 0.0f).getCentre();
+    
+    if (key.getTextCharacter() == '=' || key.getTextCharacter() == '+')
+    {
+        zoomAround(centre, zoom * keyZoomStep);
+        return true;
+    }
+    
+    if (key.getTextCharacter() == '-')
+    {
+        zoomAround(centre, zoom / keyZoomStep);
+        return true;
+    }
+    
+    if (key.getTextCharacter() == '0')
+    {
+        setView(1.0f, {});
+        return true;
+    }
+    
+    const bool isUndo = key.getKeyCode() == 'Z' && !modifiers.isShiftDown();
+    const bool isRedo = (key.getKeyCode() == 'Z' && modifiers.isShiftDown()) || (key.getKeyCode() == 'Y' && !modifiers.isShiftDown());
+    
+    if (!isUndo && !isRedo) return false;
+    
+    // the node and stream ids being shown may not mean the same thing afterwards
+    setSelection();
+    
+    if (isUndo)
+        dataManager->undo();
+    else
+        dataManager->redo();
+    
+    return true;
+}
+
+void FXGraphAudioProcessorEditor::mouseDown(const juce::MouseEvent&)
+{
+    grabKeyboardFocus(); // otherwise the shortcuts do nothing until something else has had focus
+    
+    panAtDragStart = pan;
+}
+
+void FXGraphAudioProcessorEditor::mouseDrag(const juce::MouseEvent& event)
+{
+    setView(zoom, panAtDragStart + event.getOffsetFromDragStart().toFloat());
+}
+
+void FXGraphAudioProcessorEditor::mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel)
+{
+    if (m_sideMenu.isParentOf(event.eventComponent)) return; // passed up from something in the menu that doesn't scroll
+    
+    if (event.mods.isCommandDown())
+        zoomAround(event.position, zoom * (1.0f + wheel.deltaY));
+    else
+        setView(zoom, pan + juce::Point<float>(wheel.deltaX, wheel.deltaY) * scrollSpeed);
+}
+
+void FXGraphAudioProcessorEditor::mouseMagnify(const juce::MouseEvent& event, float scaleFactor)
+{
+    if (m_sideMenu.isParentOf(event.eventComponent)) return;
+    
+    zoomAround(event.position, zoom * scaleFactor);
+}
+
+void FXGraphAudioProcessorEditor::zoomAround(juce::Point<float> position, float newZoom)
+{
+    newZoom = juce::jlimit(minZoom, maxZoom, newZoom);
+    
+    const auto graphPosition = (position - pan) / zoom;
+    
+    setView(newZoom, position - graphPosition * newZoom);
+}
+
+void FXGraphAudioProcessorEditor::setView(float newZoom, juce::Point<float> newPan)
+{
+    zoom = newZoom;
+    pan = newPan;
+    
+    m_graphAreaNodeContainer.setViewTransform(getViewTransform());
+    m_graphAreaStreams.setViewTransform(getViewTransform());
+    
+    updateDraggableArea();
+    updateVisibleNodes();
+    
+    repaint(); // the dot grid moves with the view
+}
+
+void FXGraphAudioProcessorEditor::updateDraggableArea()
+{
+    auto globalBounds = getBounds().toFloat();
+    
+    if (m_sideMenu.getShown()) {
+        globalBounds.setLeft(300); // hardcoded side-panel width
+    }
+    
+    draggableArea = globalBounds.transformedBy(getViewTransform().inverted());
+}
+
+void FXGraphAudioProcessorEditor::updateVisibleNodes()
+{
+    auto visibleArea = m_graphAreaNodeContainer.getVisibleArea().expanded(visibleMargin / zoom).getSmallestIntegerContainer();
+    
+    const bool useComponents = zoom >= minComponentZoom;
+    
+    for (int nodeId = 0; nodeId < graphNodes.size(); nodeId++)
+    {
+        auto n = graphNodes[nodeId];
+        
+        const bool wantsComponent = useComponents && n->bounds.intersects(visibleArea);
+        
+        if (wantsComponent && n->component == nullptr)
+        {
+            auto node = dataManager->getActiveInstance()->nodes[nodeId];
+            
+            // an edit may have been swapped in that the nodes haven't been reconciled with yet; the component is made once they have
+            if (node != nullptr && node->uid == n->uid)
+                createComponent(n, nodeId);
+        }
+        else if (!wantsComponent && n->component != nullptr && !n->component->getIsBeingDragged())
+            n->component.reset();
+    }
     
+    m_graphAreaNodeContainer.repaint(); // for the nodes it draws itself
 }
 
 void FXGraphAudioProcessorEditor::addNode(Data::Node* node, int nodeId)
 {
     auto* n = new Common::Node();
     
+    n->uid = node->uid;
+    n->bounds = GraphNode::getIdealBounds(node, dataManager->layout.getPosition(node->uid));
+    
+    graphNodes.add(n); // the component is made by updateVisibleNodes(), if it's on screen
+}
+
+void FXGraphAudioProcessorEditor::createComponent(Common::Node* n, int nodeId)
+{
     n->component.reset(new GraphNode(dataManager, nodeId, draggableArea));
     
     m_graphAreaNodeContainer.addAndMakeVisible(n->component.get());
-    n->component->setBounds(node->position.x, node->position.y, node->hasInputSide && node->hasOutputSide ? 300 : 150, n->component->getIdealHeight());
-    
-    graphNodes.add(n);
-    
+    n->component->setBounds(n->bounds);
+    n->component->setSelected(nodeSelected && selectedNodeId == nodeId);
     
-    n->component->onMove = [this] () {
-        m_graphAreaStreams.repaint();
+    n->component->onMove = [this, n] () {
+        n->bounds = n->component->getBounds();
+        m_graphAreaStreams.invalidateNode(n->component->getNodeId());
     };
     
     n->component->onDataUpdate = [this] () { // TODO: maybe remove?
@@ -83,46 +251,19 @@ void FXGraphAudioProcessorEditor::addNode(Data::Node* node, int nodeId)
     };
     
     n->component->onRemove = [this, n] () {
-        int nodeId = n->component->getNodeId();
+        if (nodeSelected) setSelection();
         
-        dataManager->startEditing();
-        dataManager->removeNode(nodeId);
-        dataManager->finishEditing();
-        
-        // bump all node ids for node components
-        
-        graphNodes.removeObject(n);
-        
-        for (auto node : graphNodes)
-        {
-            if (node->component->getNodeId() > nodeId)
-                node->component->setNodeId(node->component->getNodeId() - 1);
-        }
-        
-        m_graphAreaStreams.repaint();
+        // the component goes, and the ids of the ones after it are bumped, once the edit is realised
+        dataManager->perform(new Edit::RemoveNode(n->component->getNodeId()));
     };
     
     n->component->getCollidingRects = [this] (GraphNode& graphNode, float padding) -> juce::Array<juce::Rectangle<float>>
     {
-        auto thisBounds = graphNode.getBounds().toFloat();
-        
-        juce::Array<juce::Rectangle<float>> out;
-        
-        for (auto node : graphNodes)
-        {
-            if (node->component.get() == &graphNode) continue;
-            
-            auto b = node->component->getBounds().toFloat().expanded(padding);
-            
-            if (thisBounds.intersects(b))
-                out.add(b);
-        }
-        
-        return out;
+        return m_graphAreaNodeContainer.getCollidingRects(graphNode, padding);
     };
     
-    n->component->onDragStreamStart = [this, nodeId] (InputOrOutput inputOrOutput, int paramId) {
-        m_graphAreaStreams.handleStartDragStream(nodeId, inputOrOutput, paramId);
+    n->component->onDragStreamStart = [this, n] (InputOrOutput inputOrOutput, int paramId) {
+        m_graphAreaStreams.handleStartDragStream(n->component->getNodeId(), inputOrOutput, paramId);
     };
     
     n->component->onDragStream = [this] (InputOrOutput inputOrOutput, int paramId, juce::Point<float> position) {
@@ -138,20 +279,105 @@ void FXGraphAudioProcessorEditor::addNode(Data::Node* node, int nodeId)
     };
 }
 
+void FXGraphAudioProcessorEditor::updateNodeLayout(int uid)
+{
+    for (int nodeId = 0; nodeId < graphNodes.size(); nodeId++)
+    {
+        auto n = graphNodes[nodeId];
+        
+        if (n->uid != uid) continue;
+        
+        auto node = dataManager->getActiveInstance()->nodes[nodeId];
+        
+        if (node == nullptr || node->uid != uid) return; // reconcileNodes() will pick it up once the graph is realised
+        
+        if (n->component != nullptr && n->component->getIsBeingDragged()) return;
+        
+        n->bounds = GraphNode::getIdealBounds(node, dataManager->layout.getPosition(uid));
+        
+        if (n->component != nullptr)
+        {
+            n->component->setBounds(n->bounds);
+            n->component->update(); // for the label
+        }
+        
+        m_graphAreaStreams.invalidateNode(nodeId);
+        updateVisibleNodes(); // it may have moved on or off screen
+        return;
+    }
+}
+
 void FXGraphAudioProcessorEditor::resetNodes()
 {
+    if (nodeSelected) setSelection();
+    
     graphNodes.clear();
     
-    for (int nodeId = 0; nodeId < NUM_NODES; nodeId++) // TODO: put this in a function because all this will need to be repeated when i add nodes using the UI and also when i add nodes from data load stuff
+    reconcileNodes();
+}
+
+void FXGraphAudioProcessorEditor::reconcileNodes()
+{
+    auto selectedNode = nodeSelected ? graphNodes[selectedNodeId] : nullptr;
+    
+    // graphNodes is kept in node id order, so take the nodes that are still wanted out of it in that order, and whatever's left over is for nodes that have gone
+    
+    juce::OwnedArray<Common::Node> reconciled;
+    
+    for (int nodeId = 0; nodeId < NUM_NODES; nodeId++)
     {
-        auto node = dataManager->activeInstance->nodes[nodeId];
+        auto node = dataManager->getActiveInstance()->nodes[nodeId];
         
         if (node == nullptr || !node->isActive) break;
         
-        addNode(node, nodeId);
+        int index = 0;
+        while (index < graphNodes.size() && graphNodes[index]->uid != node->uid) index++;
+        
+        if (index == graphNodes.size())
+        { // a new node
+            addNode(node, nodeId);
+            reconciled.add(graphNodes.removeAndReturn(graphNodes.size() - 1));
+            continue;
+        }
+        
+        auto n = graphNodes.removeAndReturn(index);
+        auto component = n->component.get();
+        
+        if (component == nullptr || !component->getIsBeingDragged())
+            n->bounds = GraphNode::getIdealBounds(node, dataManager->layout.getPosition(node->uid));
+        
+        if (component != nullptr)
+        {
+            component->setNodeId(nodeId);
+            component->update();
+            
+            if (!component->getIsBeingDragged())
+                component->setBounds(n->bounds);
+        }
+        
+        reconciled.add(n);
+    }
+    
+    graphNodes.swapWith(reconciled); // and the nodes left in reconciled are deleted with it, along with any components
+    
+    if (selectedNode != nullptr)
+    {
+        int index = graphNodes.indexOf(selectedNode);
+        
+        if (index == -1)
+        {
+            setSelection();
+        } else if (index != selectedNodeId)
+        {
+            selectedNodeId = index;
+            m_graphAreaNodeContainer.setSelectedNode(index);
+            m_sideMenu.getInspector()->setSelection(index);
+        }
     }
     
+    updateVisibleNodes();
     
+    m_graphAreaStreams.invalidateStreams();
 }
 
 //==============================================================================
@@ -159,42 +385,45 @@ void FXGraphAudioProcessorEditor::paint (juce::Graphics& g)
 {
     // Background for Graph Area
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-    juce::Rectangle<float> backgroundRect = getLocalBounds().toFloat();
     
-    g.setColour (juce::Colour (0xff60636C));
+    if (dotSpacing * zoom < minDotSpacing) return;
     
-    const float startX = 2;
-    const float intX = 10;
-    const float offsetX = intX / 2.0;
-    
-    const float startY = 2;
-    const float intY = 10;
-    const float diameter = 2;
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor() * zoom;
     
-    bool offset = false;
+    if (!dotTile.isValid() || scale != dotTileScale)
+        renderDotTile(scale);
     
-    for (float y = startY; y < backgroundRect.getHeight(); y += intY) {
-        offset = !offset;
-        for (float x = startX + (offset ? offsetX : 0); x < backgroundRect.getWidth(); x += intX) {
-            g.fillEllipse(x, y, diameter, diameter);
-        }
-    }
+    // the tile is dotSpacing by 2 * dotSpacing of graph space, however many pixels it was rounded to
+    const auto tileToGraph = juce::AffineTransform::scale(dotSpacing / dotTile.getWidth(), 2.0f * dotSpacing / dotTile.getHeight());
     
-
+    g.setFillType(juce::FillType(dotTile, tileToGraph.followedBy(getViewTransform())));
+    g.fillRect(getLocalBounds());
 }
 
-void FXGraphAudioProcessorEditor::resized()
+void FXGraphAudioProcessorEditor::renderDotTile(float scale)
 {
-    auto globalBounds = getBounds();
+    dotTileScale = scale;
     
-    draggableArea.setPosition(globalBounds.getX(), globalBounds.getY());
-    draggableArea.setSize(globalBounds.getWidth(), globalBounds.getHeight());
+    const int width = juce::jmax(1, juce::roundToInt(dotSpacing * scale));
+    const int height = juce::jmax(1, juce::roundToInt(2.0f * dotSpacing * scale));
     
-    if (m_sideMenu.getShown()) {
-        draggableArea.setLeft(300); // hardcoded side-panel width
-    }
+    dotTile = juce::Image(juce::Image::ARGB, width, height, true);
+    
+    juce::Graphics g(dotTile);
+    g.addTransform(juce::AffineTransform::scale(width / dotSpacing, height / (2.0f * dotSpacing)));
+    
+    g.setColour (juce::Colour (0xff60636C));
+    
+    const float start = 2;
+    const float diameter = 2;
     
+    // the same pattern as before the canvas moved: every other row offset by half the spacing
+    g.fillEllipse(start + dotSpacing / 2.0f, start, diameter, diameter);
+    g.fillEllipse(start, start + dotSpacing, diameter, diameter);
+}
+
+void FXGraphAudioProcessorEditor::resized()
+{
     auto menuBounds = getLocalBounds();
     
     menuBounds.setRight(300 + 50);
@@ -204,15 +433,21 @@ void FXGraphAudioProcessorEditor::resized()
     m_graphAreaStreams.setBounds(getLocalBounds());
     
     m_graphAreaNodeContainer.setBounds(getLocalBounds());
+    
+    // more or less of the graph is on screen now
+    updateDraggableArea();
+    updateVisibleNodes();
 }
 
 void FXGraphAudioProcessorEditor::setSelection(ParameterType type, int streamId)
 {
-    if (nodeSelected)
+    if (nodeSelected && graphNodes[selectedNodeId] != nullptr && graphNodes[selectedNodeId]->component != nullptr)
     {
         graphNodes[selectedNodeId]->component->setSelected(false);
     }
     
+    m_graphAreaNodeContainer.setSelectedNode(-1);
+    
     streamSelected = true;
     nodeSelected = false;
     
@@ -232,13 +467,13 @@ void FXGraphAudioProcessorEditor::setSelection(ParameterType type, int streamId)
 
 void FXGraphAudioProcessorEditor::setSelection(int nodeId)
 {
-    selectedNodeId = nodeId;
-    
-    if (nodeSelected)
+    if (nodeSelected && graphNodes[selectedNodeId] != nullptr && graphNodes[selectedNodeId]->component != nullptr)
     {
         graphNodes[selectedNodeId]->component->setSelected(false);
     }
     
+    selectedNodeId = nodeId;
+    
     streamSelected = false;
     nodeSelected = true;
     
@@ -251,7 +486,10 @@ void FXGraphAudioProcessorEditor::setSelection(int nodeId)
      [x] the inspector must be notified that a node has been selected for it to display appropriate data
     */
     
-    graphNodes[selectedNodeId]->component->setSelected(true);
+    if (graphNodes[selectedNodeId]->component != nullptr)
+        graphNodes[selectedNodeId]->component->setSelected(true);
+    
+    m_graphAreaNodeContainer.setSelectedNode(selectedNodeId);
     
     m_sideMenu.getInspector()->setSelection(nodeId);
 }
@@ -259,10 +497,12 @@ void FXGraphAudioProcessorEditor::setSelection(int nodeId)
 
 void FXGraphAudioProcessorEditor::setSelection()
 {
+    if (nodeSelected && graphNodes[selectedNodeId] != nullptr && graphNodes[selectedNodeId]->component != nullptr)
+        graphNodes[selectedNodeId]->component->setSelected(false);
+    
     streamSelected = false;
     nodeSelected = false;
     
     m_graphAreaStreams.selectStream();
-    
-    //TODO: tell node that not selected
+    m_graphAreaNodeContainer.setSelectedNode(-1);
 }
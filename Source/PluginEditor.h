@@ -29,7 +29,17 @@ public:
     void paint (juce::Graphics&) override;
     void resized() override;
     
-    void resetNodes();
+    bool keyPressed(const juce::KeyPress& key) override; // undo and redo, zooming with command and +, - or 0, and panning with the arrow keys
+    
+    // dragging the empty canvas pans, scrolling pans, and pinching or scrolling with the command key zooms
+    void mouseDown(const juce::MouseEvent& event) override;
+    void mouseDrag(const juce::MouseEvent& event) override;
+    void mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel) override;
+    void mouseMagnify(const juce::MouseEvent& event, float scaleFactor) override;
+    
+    void resetNodes(); // rebuilds every node component, for when the whole graph has been replaced
+    void reconcileNodes(); // only adds, updates or removes the components whose nodes have changed, matching them by uid
+    void updateNodeLayout(int uid); // after a move or relabel, which doesn't change the graph so isn't realised
 
 private:
     
@@ -38,12 +48,34 @@ private:
     void setSelection(); // clear selection
     
     void addNode(Data::Node* node, int nodeId);
+    void createComponent(Common::Node* n, int nodeId);
+    
+    // only the nodes on screen get a component, and only while the view is zoomed in far enough for one to be usable; the node container draws the rest
+    void updateVisibleNodes();
+    
+    // the view onto graph space, which is where nodes are saved: graph positions are scaled by zoom and then offset by pan
+    void setView(float newZoom, juce::Point<float> newPan);
+    void zoomAround(juce::Point<float> position, float newZoom); // keeping whatever's under position there
+    juce::AffineTransform getViewTransform() {return juce::AffineTransform::scale(zoom).translated(pan);}
+    void updateDraggableArea();
     
-    bool streamSelected;
+    float zoom = 1.0f;
+    juce::Point<float> pan;
+    juce::Point<float> panAtDragStart;
+    
+    static constexpr float minZoom = 0.1f;
+    static constexpr float maxZoom = 2.0f;
+    static constexpr float minComponentZoom = 0.5f;
+    static constexpr float scrollSpeed = 300.0f; // pixels per unit of wheel delta
+    static constexpr float keyZoomStep = 1.25f;
+    static constexpr float keyPanStep = 50.0f; // pixels
+    static constexpr float visibleMargin = 50.0f; // nodes this close to the edge get components too, so their shadows don't pop in
+    
+    bool streamSelected = false;
     ParameterType selectedStreamType;
     int selectedStreamId;
     
-    bool nodeSelected;
+    bool nodeSelected = false;
     int selectedNodeId;
     
     struct KeepInAreaConstrainer;
@@ -52,7 +84,15 @@ private:
     // access the processor object that created it.
     FXGraphAudioProcessor& audioProcessor;
     
-    juce::Rectangle<float> draggableArea;
+    juce::Rectangle<float> draggableArea; // in graph space, so it moves with the view
+    
+    // one repeat of the dot grid, drawn in graph space and tiled through the view transform, so it only changes with the zoom
+    void renderDotTile(float scale);
+    juce::Image dotTile;
+    float dotTileScale = 0;
+    
+    static constexpr float dotSpacing = 10.0f; // graph units, with every other row offset by half of this
+    static constexpr float minDotSpacing = 4.0f; // pixels, below which the grid is left out rather than drawn as a smear
     
     juce::OwnedArray<Common::Node> graphNodes;
     
@@ -28,6 +28,9 @@ FXGraphAudioProcessor::FXGraphAudioProcessor()
     // handmake some data for now
     
     dataManager.reset(new DataManager());
+    
+    hostParameters.addTo(*this);
+    dataManager->setHostParameters(&hostParameters);
 }
 
 FXGraphAudioProcessor::~FXGraphAudioProcessor()
@@ -69,7 +72,7 @@ bool FXGraphAudioProcessor::isMidiEffect() const
 
 double FXGraphAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return dataManager->getActiveInstance()->getTailSeconds();
 }
 
 int FXGraphAudioProcessor::getNumPrograms()
@@ -104,26 +107,11 @@ void FXGraphAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBloc
     
     
     
-    // Setting the size of all audio stream buffers
-    // TODO: see if it is possible to only set the size of used audio stream buffers. this may not be the case, but hopefully for RAM reasons it is
-    
-    for (int i = 0; i < NUM_AUDIO_STREAMS; i++)
-    {
-        dataManager->activeInstance->audioStreams[i].buffer.setSize(getTotalNumInputChannels(), samplesPerBlock);
-        dataManager->activeInstance->audioStreams[i].buffer.clear(); // in case there is garbage
-        
-        dataManager->inactiveInstance->audioStreams[i].buffer.setSize(getTotalNumInputChannels(), samplesPerBlock);
-        dataManager->inactiveInstance->audioStreams[i].buffer.clear(); // in case there is garbage
-
-    }
+    // Setting the size of all audio stream buffers, and the rates of anything that depends on the sample rate
     
-    // prepare the envelopes of the value streams:
+    dataManager->prepareToPlay(sampleRate, getBusesLayout().getMainInputChannelSet(), samplesPerBlock, getProcessingPrecision() == juce::AudioProcessor::doublePrecision);
     
-    for (int i = 0; i < NUM_VALUE_STREAMS; i++)
-    {
-        dataManager->activeInstance->valueStreams[i].envelope.setBlockRate(sampleRate / samplesPerBlock);
-        dataManager->inactiveInstance->valueStreams[i].envelope.setBlockRate(sampleRate / samplesPerBlock);
-    }
+    hostParameters.prepareToPlay(sampleRate);
 }
 
 void FXGraphAudioProcessor::releaseResources()
@@ -131,6 +119,8 @@ void FXGraphAudioProcessor::releaseResources()
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
     
+    hostParameters.releaseResources();
+    
     // TODO: release all the buffers
     // TODO: initialise LUFSMeter (might have to be done elsewhere)
 }
@@ -142,12 +132,11 @@ bool FXGraphAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any named layout from mono up to 7.1.4 - every stream in the graph has the bus's channels, and the
+    // loudness weighting needs to know which channel is which, so discrete layouts aren't accepted.
+    const auto& channelSet = layouts.getMainOutputChannelSet();
+    
+    if (channelSet.isDisabled() || channelSet.isDiscreteLayout() || channelSet.size() > maxChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -162,6 +151,17 @@ bool FXGraphAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 #endif
 
 void FXGraphAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, midiMessages);
+}
+
+void FXGraphAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, midiMessages);
+}
+
+template <typename SampleType>
+void FXGraphAudioProcessor::process(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages)
 {
     dataManager->startProcessing();
     dataManager->realise();
@@ -174,19 +174,27 @@ void FXGraphAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce
         buffer.clear (i, 0, buffer.getNumSamples());
     
     // processor for the output node
-    dataManager->getInputNode()->mainInput = &buffer; // ewwwwww
+    dataManager->getInputNode()->setMainInput(&buffer); // ewwwwww
     
-    dataManager->activeInstance->evaluate();
+    hostParameters.updateInputs(buffer.getNumSamples());
+    
+    dataManager->getActiveInstance()->midiOutput = &midiMessages; // incoming events are passed through, with the graph's added
+    dataManager->getActiveInstance()->numSamples = buffer.getNumSamples();
+    
+    dataManager->getActiveInstance()->evaluate();
+    
+    hostParameters.publishOutputs(buffer.getNumSamples());
     
     auto outputStreamId = dataManager->getOutputNode()->inputParams[0].streamId;
     
-    if (outputStreamId == -1)
+    if (dataManager->getActiveInstance()->isSilent(outputStreamId)) // includes not connected
     {
         buffer.clear();
+        dataManager->finishProcessing();
         return;
     }
     
-    auto b = dataManager->activeInstance->audioStreams[outputStreamId].buffer;
+    auto& b = dataManager->getActiveInstance()->audioStreams[outputStreamId].getBuffer<SampleType>();
     
     for (int channel = 0; channel < totalNumInputChannels; ++channel)
     {
@@ -214,7 +222,7 @@ void FXGraphAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
     
-    auto data = dataManager->activeInstance->serialise();
+    auto data = dataManager->serialise();
     
     copyXmlToBinary(*data, destData);
     
@@ -228,14 +236,16 @@ void FXGraphAudioProcessor::setStateInformation (const void* data, int sizeInByt
     
     auto xml = getXmlFromBinary(data, sizeInBytes);
     
-    if (xml->getNumChildElements() == 0) return;
+    if (xml == nullptr || xml->getNumChildElements() == 0) return;
     
     dataManager->startEditing();
     
-    dataManager->inactiveInstance->deserialise(xml.get());
+    dataManager->deserialise(xml.get());
     
     dataManager->finishEditing();
     
+    dataManager->clearHistory(); // none of it applies to the restored graph
+    
     auto editor = (FXGraphAudioProcessorEditor*) getActiveEditor();
     
     if (editor == nullptr)
@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "DataManager.h"
+#include "HostParameters.h"
 
 //==============================================================================
 /**
@@ -28,8 +29,13 @@ public:
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
+    
+    static constexpr int maxChannels = 12; // 7.1.4
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    
+    bool supportsDoublePrecisionProcessing() const override {return true;} // the graph runs in whichever precision the host mixes in
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -53,9 +59,16 @@ public:
     //==============================================================================
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
+    
+    std::shared_ptr<DataManager> getDataManager() {return dataManager;} // for the tests, which edit the graph as the editor would
 
 private:
     std::shared_ptr<DataManager> dataManager;
+    HostParameters hostParameters;
+    
+    template <typename SampleType>
+    void process(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages);
+    
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FXGraphAudioProcessor)
@@ -0,0 +1,23 @@
+/*
+  ==============================================================================
+  
+    SharedResources.cpp
+    Created: 19 Oct 2026 4:47:52pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include "SharedResources.h"
+#include "SpectrumCache.h"
+
+SharedResources::SharedResources() : spectrumFFT(SpectrumCache::fftOrder), spectrumWindow(SpectrumCache::fftSize, juce::dsp::WindowingFunction<float>::hann, false)
+{
+}
+
+bool SharedResources::compileExpression(const std::string& expressionString, exprtk::expression<float>& expression)
+{
+    const juce::ScopedLock sl(parserLock);
+    
+    return parser.compile(expressionString, expression);
+}
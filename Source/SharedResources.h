@@ -0,0 +1,39 @@
+/*
+  ==============================================================================
+  
+    SharedResources.h
+    Created: 19 Oct 2026 4:47:52pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "exprtk/exprtk.hpp"
+
+/**
+ Read-only objects that every plugin instance in the process can use at once, instead of each node owning a copy.
+ Hold one with a juce::SharedResourcePointer<SharedResources>: the first pointer creates it, and it's deleted along with the last, so a host with a hundred instances open pays for one FFT plan, one window table and one expression parser between them.
+ The FFT and window are only read once they've been made, so they're safe to use from any thread. The parser isn't, so expressions are compiled through compileExpression(), which holds a lock for the length of the compile; compiling only ever happens on the message thread, so the lock is never contended by the audio thread.
+ */
+class SharedResources
+{
+public:
+    SharedResources();
+    
+    const juce::dsp::FFT& getSpectrumFFT() {return spectrumFFT;}
+    const juce::dsp::WindowingFunction<float>& getSpectrumWindow() {return spectrumWindow;}
+    
+    bool compileExpression(const std::string& expressionString, exprtk::expression<float>& expression); // returns success
+    
+private:
+    juce::dsp::FFT spectrumFFT;
+    juce::dsp::WindowingFunction<float> spectrumWindow;
+    
+    exprtk::parser<float> parser;
+    juce::CriticalSection parserLock;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SharedResources)
+};
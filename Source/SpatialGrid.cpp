@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+  
+    SpatialGrid.cpp
+    Created: 19 Oct 2026 9:20:44pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include "SpatialGrid.h"
+
+void SpatialGrid::clear()
+{
+    cells.clear();
+    boundsById.clear();
+}
+
+juce::Rectangle<int> SpatialGrid::getCellRange(juce::Rectangle<float> bounds)
+{
+    const int left = (int) std::floor(bounds.getX() / cellSize);
+    const int top = (int) std::floor(bounds.getY() / cellSize);
+    const int right = (int) std::floor(bounds.getRight() / cellSize);
+    const int bottom = (int) std::floor(bounds.getBottom() / cellSize);
+    
+    return {left, top, right - left, bottom - top};
+}
+
+void SpatialGrid::insert(int id, juce::Rectangle<float> bounds)
+{
+    jassert(!contains(id));
+    
+    boundsById[id] = bounds;
+    
+    auto range = getCellRange(bounds);
+    
+    for (int y = range.getY(); y <= range.getBottom(); y++)
+        for (int x = range.getX(); x <= range.getRight(); x++)
+            cells[getKey(x, y)].add(id);
+}
+
+void SpatialGrid::remove(int id)
+{
+    auto found = boundsById.find(id);
+    
+    if (found == boundsById.end()) return;
+    
+    auto range = getCellRange(found->second);
+    
+    for (int y = range.getY(); y <= range.getBottom(); y++)
+    {
+        for (int x = range.getX(); x <= range.getRight(); x++)
+        {
+            auto cell = cells.find(getKey(x, y));
+            
+            if (cell == cells.end()) continue;
+            
+            cell->second.removeFirstMatchingValue(id);
+            
+            if (cell->second.isEmpty()) cells.erase(cell);
+        }
+    }
+    
+    boundsById.erase(found);
+}
+
+void SpatialGrid::move(int id, juce::Rectangle<float> bounds)
+{
+    auto found = boundsById.find(id);
+    
+    if (found != boundsById.end())
+    {
+        if (found->second == bounds) return;
+        
+        // only re-file it if it's moved into different cells
+        if (getCellRange(found->second) == getCellRange(bounds))
+        {
+            found->second = bounds;
+            return;
+        }
+        
+        remove(id);
+    }
+    
+    insert(id, bounds);
+}
+
+void SpatialGrid::query(juce::Point<float> point, juce::Array<int>& results)
+{
+    results.clearQuick();
+    
+    auto cell = cells.find(getKey((int) std::floor(point.getX() / cellSize), (int) std::floor(point.getY() / cellSize)));
+    
+    if (cell == cells.end()) return;
+    
+    for (int id : cell->second)
+    {
+        if (boundsById[id].contains(point))
+            results.add(id);
+    }
+}
+
+void SpatialGrid::query(juce::Rectangle<float> area, juce::Array<int>& results)
+{
+    results.clearQuick();
+    
+    auto range = getCellRange(area);
+    
+    for (int y = range.getY(); y <= range.getBottom(); y++)
+    {
+        for (int x = range.getX(); x <= range.getRight(); x++)
+        {
+            auto cell = cells.find(getKey(x, y));
+            
+            if (cell == cells.end()) continue;
+            
+            for (int id : cell->second)
+            {
+                if (boundsById[id].intersects(area))
+                    results.addIfNotAlreadyThere(id);
+            }
+        }
+    }
+}
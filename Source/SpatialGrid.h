@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+  
+    SpatialGrid.h
+    Created: 19 Oct 2026 9:20:44pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <unordered_map>
+
+/**
+ A uniform grid of bounding boxes, for finding what's near a point or rectangle without checking everything on the canvas.
+ Each id is filed under every cell its bounds overlap, so a query only looks at the few cells it touches; the grid is unbounded, and cells that nothing overlaps aren't stored.
+ Queries only narrow things down by bounding box, so callers still do their own exact test on what comes back.
+ */
+class SpatialGrid
+{
+public:
+    SpatialGrid(float cellSize_ = 64.0f) : cellSize(cellSize_) {};
+    
+    void clear();
+    
+    void insert(int id, juce::Rectangle<float> bounds);
+    void remove(int id);
+    void move(int id, juce::Rectangle<float> bounds); // insert or re-file
+    
+    bool contains(int id) {return boundsById.count(id) > 0;}
+    
+    void query(juce::Point<float> point, juce::Array<int>& results); // ids whose bounds contain point
+    void query(juce::Rectangle<float> area, juce::Array<int>& results); // ids whose bounds intersect area, each once
+    
+private:
+    juce::Rectangle<int> getCellRange(juce::Rectangle<float> bounds); // inclusive
+    static juce::uint64 getKey(int x, int y) {return (juce::uint64) (juce::uint32) x << 32 | (juce::uint32) y;} // through unsigned, since shifting a negative cell index is undefined
+    
+    float cellSize;
+    
+    std::unordered_map<juce::uint64, juce::Array<int>> cells;
+    std::unordered_map<int, juce::Rectangle<float>> boundsById;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpatialGrid)
+};
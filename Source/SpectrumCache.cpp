@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+  
+    SpectrumCache.cpp
+    Created: 19 Oct 2026 9:12:40am
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include "SpectrumCache.h"
+
+// equivalent noise bandwidth of the hann window, in bins, so a sine's leakage sums back to its own power
+static const double hannNoiseBandwidth = 1.5;
+
+SpectrumCache::SpectrumCache(double sampleRate_)
+{
+    setSampleRate(sampleRate_);
+    reset();
+}
+
+void SpectrumCache::setSampleRate(double sampleRate_)
+{
+    jassert(sampleRate_ > 0.0);
+    sampleRate = sampleRate_;
+}
+
+void SpectrumCache::reset()
+{
+    juce::FloatVectorOperations::clear(fifo, fftSize);
+    juce::FloatVectorOperations::clear(magnitudes, numBins);
+    juce::FloatVectorOperations::clear(prevMagnitudes, numBins);
+    
+    for (int i = 0; i < numBins + 1; i++)
+        cumulativePower[i] = 0.0;
+    
+    fifoIndex = 0;
+    samplesSinceFrame = 0;
+    silentSamples = 0;
+    frameReady = false;
+    
+    centroid = flux = rolloff = flatness = 0;
+}
+
+void SpectrumCache::push(const juce::AudioBuffer<float>& buffer, bool isSilent)
+{
+    const int numChannels = buffer.getNumChannels();
+    const int numSamples = buffer.getNumSamples();
+    
+    if (numChannels == 0) return;
+    
+    if (!isSilent)
+        silentSamples = 0;
+    else if (silentSamples >= settleSamples && frameReady)
+        return;
+    else
+        silentSamples += numSamples;
+    
+    const float channelGain = 1.0f / (float) numChannels;
+    
+    int sample = 0;
+    
+    while (sample < numSamples)
+    {
+        // never write past the end of the fifo, or past the end of the current hop
+        const int numToWrite = juce::jmin(numSamples - sample, fftSize - fifoIndex, hopSize - samplesSinceFrame);
+        
+        float* dest = fifo + fifoIndex;
+        
+        juce::FloatVectorOperations::copyWithMultiply(dest, buffer.getReadPointer(0, sample), channelGain, numToWrite);
+        
+        for (int channel = 1; channel < numChannels; channel++)
+            juce::FloatVectorOperations::addWithMultiply(dest, buffer.getReadPointer(channel, sample), channelGain, numToWrite);
+        
+        sample += numToWrite;
+        fifoIndex = (fifoIndex + numToWrite) % fftSize;
+        samplesSinceFrame += numToWrite;
+        
+        if (samplesSinceFrame == hopSize)
+        {
+            samplesSinceFrame = 0;
+            computeFrame();
+        }
+    }
+}
+
+void SpectrumCache::computeFrame()
+{
+    // unroll the fifo so that the oldest sample comes first
+    const int numOldest = fftSize - fifoIndex;
+    
+    juce::FloatVectorOperations::copy(fftData, fifo + fifoIndex, numOldest);
+    juce::FloatVectorOperations::copy(fftData + numOldest, fifo, fifoIndex);
+    juce::FloatVectorOperations::clear(fftData + fftSize, fftSize);
+    
+    shared->getSpectrumWindow().multiplyWithWindowingTable(fftData, (size_t) fftSize);
+    
+    shared->getSpectrumFFT().performFrequencyOnlyForwardTransform(fftData, true);
+    
+    juce::FloatVectorOperations::copy(prevMagnitudes, magnitudes, numBins);
+    
+    // scale so that a full scale sine peaks at 1 (hann has a coherent gain of 0.5)
+    juce::FloatVectorOperations::multiply(magnitudes, fftData, 4.0f / (float) fftSize, numBins);
+    
+    computeFeatures();
+    
+    frameReady = true;
+}
+
+void SpectrumCache::computeFeatures()
+{
+    double weightedSum = 0.0;
+    double magnitudeSum = 0.0;
+    double logPowerSum = 0.0;
+    double fluxSum = 0.0;
+    
+    const double epsilon = 1e-12;
+    
+    cumulativePower[0] = 0.0;
+    
+    for (int bin = 0; bin < numBins; bin++)
+    {
+        const double magnitude = magnitudes[bin];
+        const double power = magnitude * magnitude;
+        
+        cumulativePower[bin + 1] = cumulativePower[bin] + power / hannNoiseBandwidth;
+        
+        weightedSum += magnitude * getBinFrequency((float) bin);
+        magnitudeSum += magnitude;
+        logPowerSum += std::log(power + epsilon);
+        
+        const double rise = magnitude - prevMagnitudes[bin];
+        if (rise > 0.0) fluxSum += rise;
+    }
+    
+    const double totalPower = cumulativePower[numBins];
+    
+    flux = (float) fluxSum;
+    
+    if (totalPower <= epsilon)
+    { // nothing to describe
+        centroid = rolloff = flatness = 0;
+        return;
+    }
+    
+    centroid = (float) (weightedSum / magnitudeSum);
+    
+    const double rolloffPower = totalPower * rolloffFraction;
+    
+    int rolloffBin = 0;
+    while (rolloffBin < numBins - 1 && cumulativePower[rolloffBin + 1] < rolloffPower) rolloffBin++;
+    
+    rolloff = getBinFrequency((float) rolloffBin);
+    
+    // geometric mean over arithmetic mean of the power spectrum
+    const double arithmeticMean = totalPower * hannNoiseBandwidth / numBins + epsilon;
+    const double geometricMean = std::exp(logPowerSum / numBins);
+    
+    flatness = (float) juce::jlimit(0.0, 1.0, geometricMean / arithmeticMean);
+}
+
+float SpectrumCache::getBandEnergy(float lowHz, float highHz)
+{
+    if (lowHz > highHz) std::swap(lowHz, highHz);
+    
+    const float binWidth = getBinFrequency(1.0f);
+    
+    const int lowBin = juce::jlimit(0, numBins - 1, juce::roundToInt(lowHz / binWidth));
+    const int highBin = juce::jlimit(lowBin, numBins - 1, juce::roundToInt(highHz / binWidth));
+    
+    const double power = cumulativePower[highBin + 1] - cumulativePower[lowBin];
+    
+    return juce::Decibels::gainToDecibels((float) std::sqrt(juce::jmax(0.0, power)));
+}
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+  
+    SpectrumCache.h
+    Created: 19 Oct 2026 9:12:40am
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SharedResources.h"
+
+/**
+ A windowed, overlapping FFT of one audio stream, shared by every spectral node reading that stream.
+ Incoming audio is summed to mono into a FIFO, and a new frame is only transformed once every hopSize samples, so the FFT runs at most once per hop no matter how many nodes read from it.
+ The scalar features are worked out once per frame as well; band energy is read from a cumulative power table so each band query is O(1).
+ The FFT plan and window table are the process-wide ones in SharedResources, since they only depend on fftSize.
+ */
+class SpectrumCache
+{
+public:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = fftSize / 4;
+    static constexpr int numBins = fftSize / 2 + 1;
+    
+    SpectrumCache(double sampleRate_);
+    
+    void setSampleRate(double sampleRate_);
+    void reset();
+    
+    void push(const juce::AudioBuffer<float>& buffer, bool isSilent = false); // runs a transform for every hop completed
+    
+    // once this much silence has been pushed the fifo, the frame and the previous frame are all zeros, so more silence changes nothing
+    static constexpr int settleSamples = fftSize + 2 * hopSize;
+    
+    bool hasFrame() {return frameReady;}
+    
+    float getBinFrequency(float bin) {return bin * (float) sampleRate / (float) fftSize;}
+    
+    float getBandEnergy(float lowHz, float highHz); // dBFS of a full scale sine
+    float getCentroid() {return centroid;} // Hz
+    float getFlux() {return flux;}
+    float getRolloff() {return rolloff;} // Hz
+    float getFlatness() {return flatness;} // 0 (tonal) to 1 (noise)
+    
+    static constexpr float rolloffFraction = 0.85f;
+
+private:
+    void computeFrame();
+    void computeFeatures();
+    
+    juce::SharedResourcePointer<SharedResources> shared;
+    
+    double sampleRate;
+    
+    float fifo[fftSize];
+    int fifoIndex = 0;
+    int samplesSinceFrame = 0;
+    int silentSamples = 0;
+    
+    float fftData[fftSize * 2];
+    float magnitudes[numBins];
+    float prevMagnitudes[numBins];
+    double cumulativePower[numBins + 1]; // cumulativePower[k] is the power of bins [0, k)
+    
+    bool frameReady = false;
+    
+    float centroid = 0;
+    float flux = 0;
+    float rolloff = 0;
+    float flatness = 0;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumCache)
+};
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+  
+    SwapLatencyStats.cpp
+    Created: 19 Oct 2026 7:48:22pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include "SwapLatencyStats.h"
+
+SwapLatencyStats::SwapLatencyStats()
+{
+    for (auto& count : counts)
+        count.store(0);
+    
+    numSwaps.store(0);
+}
+
+void SwapLatencyStats::add(double ms)
+{
+    const int bucket = juce::jlimit(0, numBuckets, (int) (ms / bucketMs));
+    
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    numSwaps.fetch_add(1, std::memory_order_relaxed);
+}
+
+int SwapLatencyStats::getNumSwaps()
+{
+    return (int) numSwaps.load(std::memory_order_relaxed);
+}
+
+double SwapLatencyStats::getPercentile(double percentile)
+{
+    const int total = getNumSwaps();
+    
+    if (total == 0) return 0.0;
+    
+    const double target = total * percentile / 100.0;
+    
+    juce::uint32 cumulative = 0;
+    
+    for (int bucket = 0; bucket <= numBuckets; bucket++)
+    {
+        cumulative += counts[bucket].load(std::memory_order_relaxed);
+        
+        if (cumulative >= target) return (bucket + 1) * bucketMs; // the top of the bucket, so it never under-reports
+    }
+    
+    return (numBuckets + 1) * bucketMs;
+}
+
+juce::String SwapLatencyStats::getSummary()
+{
+    return juce::String(getNumSwaps()) + " swaps, edit to audible p50 " + juce::String(getPercentile(50.0), 1)
+         + "ms, p90 " + juce::String(getPercentile(90.0), 1)
+         + "ms, p99 " + juce::String(getPercentile(99.0), 1)
+         + "ms, max " + juce::String(getPercentile(100.0), 1) + "ms";
+}
@@ -0,0 +1,39 @@
+/*
+  ==============================================================================
+  
+    SwapLatencyStats.h
+    Created: 19 Oct 2026 7:48:22pm
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ A histogram of how long edits take to be heard: from finishEditing() queueing a change to the end of the first block the audio thread renders with it.
+ The audio thread only ever increments a counter, so recording costs nothing and never blocks; the percentiles are read from the message thread whenever they're wanted.
+ */
+class SwapLatencyStats
+{
+public:
+    SwapLatencyStats();
+    
+    void add(double ms); // audio thread
+    
+    int getNumSwaps();
+    double getPercentile(double percentile); // ms, to the resolution of a bucket
+    
+    juce::String getSummary();
+    
+    static constexpr double bucketMs = 0.1;
+    static constexpr int numBuckets = 1000; // and one more for anything slower
+    
+private:
+    std::atomic<juce::uint32> counts[numBuckets + 1];
+    std::atomic<juce::uint32> numSwaps;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SwapLatencyStats)
+};
@@ -0,0 +1,186 @@
+/*
+  ==============================================================================
+  
+    InstantiationBenchmark.cpp
+    Created: 20 Oct 2026 10:05:31am
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "Timings.h"
+
+/**
+ Loads the plugin the way a host opening a session full of it would: construct, prepare, restore a saved graph and render the first block, for many instances one after another.
+ Also times instances that are only constructed and destroyed, as when a host scans plugins.
+ */
+class InstantiationBenchmark : public juce::UnitTest
+{
+public:
+    InstantiationBenchmark() : juce::UnitTest("Instantiation", "Benchmark") {}
+    
+    static constexpr int numInstances = 200;
+    static constexpr double sampleRate = 48000;
+    static constexpr int blockSize = 512;
+    
+    void runTest() override
+    {
+        beginTest("Scanning");
+        {
+            std::vector<double> constructMs, destroyMs;
+            
+            for (int i = 0; i < numInstances; i++)
+            {
+                auto startMs = juce::Time::getMillisecondCounterHiRes();
+                
+                std::unique_ptr<FXGraphAudioProcessor> processor(new FXGraphAudioProcessor());
+                
+                constructMs.push_back(juce::Time::getMillisecondCounterHiRes() - startMs);
+                
+                startMs = juce::Time::getMillisecondCounterHiRes();
+                
+                processor.reset();
+                
+                destroyMs.push_back(juce::Time::getMillisecondCounterHiRes() - startMs);
+            }
+            
+            logMessage("Construction: " + describeTimings(constructMs));
+            logMessage("Destruction: " + describeTimings(destroyMs));
+        }
+        
+        beginTest("Loading a session");
+        {
+            juce::MemoryBlock state;
+            makeState(state);
+            
+            std::vector<double> constructMs, prepareMs, setStateMs, firstBlockMs;
+            
+            juce::OwnedArray<FXGraphAudioProcessor> processors; // kept alive, as the host keeps them, so the later ones load alongside the earlier
+            
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            juce::MidiBuffer midiMessages;
+            
+            for (int i = 0; i < numInstances; i++)
+            {
+                auto startMs = juce::Time::getMillisecondCounterHiRes();
+                
+                auto processor = processors.add(new FXGraphAudioProcessor());
+                
+                constructMs.push_back(juce::Time::getMillisecondCounterHiRes() - startMs);
+                
+                startMs = juce::Time::getMillisecondCounterHiRes();
+                
+                processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+                processor->prepareToPlay(sampleRate, blockSize);
+                
+                prepareMs.push_back(juce::Time::getMillisecondCounterHiRes() - startMs);
+                
+                startMs = juce::Time::getMillisecondCounterHiRes();
+                
+                processor->setStateInformation(state.getData(), (int) state.getSize());
+                
+                setStateMs.push_back(juce::Time::getMillisecondCounterHiRes() - startMs);
+                
+                for (int channel = 0; channel < buffer.getNumChannels(); channel++)
+                    for (int sample = 0; sample < blockSize; sample++)
+                        buffer.setSample(channel, sample, getRandom().nextFloat() * 2.0f - 1.0f);
+                
+                midiMessages.clear();
+                
+                startMs = juce::Time::getMillisecondCounterHiRes();
+                
+                processor->processBlock(buffer, midiMessages);
+                
+                firstBlockMs.push_back(juce::Time::getMillisecondCounterHiRes() - startMs);
+            }
+            
+            logMessage("Construction: " + describeTimings(constructMs));
+            logMessage("prepareToPlay: " + describeTimings(prepareMs));
+            logMessage("setStateInformation: " + describeTimings(setStateMs));
+            logMessage("First processBlock: " + describeTimings(firstBlockMs));
+            
+            // and it really was restored, rather than left as the empty graph the processor starts with
+            juce::MemoryBlock restored;
+            processors.getLast()->getStateInformation(restored);
+            
+            expectEquals(countNodes(restored), countNodes(state));
+        }
+    }
+
+private:
+    // a graph like a typical session's: the input through a gain to the output, with analysis nodes driving it and a parameter output
+    static void makeState(juce::MemoryBlock& state)
+    {
+        DataManager dataManager;
+        
+        const NodeType types[] = {NodeType::Gain, NodeType::Level, NodeType::Loudness, NodeType::SpectralFeatures, NodeType::BandEnergy, NodeType::Maths, NodeType::ParameterOutput};
+        
+        dataManager.startEditing();
+        
+        for (auto type : types)
+        {
+            const int nodeId = dataManager.inactiveInstance->getNextNodeId();
+            
+            dataManager.addNode(nodeId, type, {100.0f * (float) nodeId, 300.0f});
+            
+            // the main input into each of its audio inputs, and the node before into each of its value inputs
+            connectAll(dataManager, ParameterType::Audio, 0, nodeId);
+            
+            if (nodeId > 2) connectAll(dataManager, ParameterType::Value, nodeId - 1, nodeId);
+        }
+        
+        connectAll(dataManager, ParameterType::Audio, 2, 1); // the gain into the main output
+        
+        dataManager.finishEditing(); // swapped in straight away, since nothing is processing
+        
+        std::unique_ptr<juce::XmlElement> xml(dataManager.serialise());
+        
+        juce::AudioProcessor::copyXmlToBinary(*xml, state);
+    }
+    
+    // from the producer's first output of the type into each of the consumer's inputs of that type
+    static void connectAll(DataManager& dataManager, ParameterType type, int producerNodeId, int consumerNodeId)
+    {
+        auto instance = dataManager.inactiveInstance;
+        
+        int producerParamId = -1;
+        
+        for (int paramId = 0; paramId < NUM_PARAMS && instance->nodes[producerNodeId]->outputParams[paramId].isActive; paramId++)
+        {
+            if (instance->nodes[producerNodeId]->outputParams[paramId].type != type) continue;
+            
+            producerParamId = paramId;
+            break;
+        }
+        
+        if (producerParamId == -1) return;
+        
+        for (int paramId = 0; paramId < NUM_PARAMS && instance->nodes[consumerNodeId]->inputParams[paramId].isActive; paramId++)
+        {
+            if (instance->nodes[consumerNodeId]->inputParams[paramId].type != type) continue;
+            
+            dataManager.connect(type, {producerNodeId, producerParamId}, {consumerNodeId, paramId});
+        }
+    }
+    
+    static int countNodes(const juce::MemoryBlock& state)
+    {
+        auto xml = juce::AudioProcessor::getXmlFromBinary(state.getData(), (int) state.getSize());
+        
+        if (xml == nullptr) return -1;
+        
+        int numNodes = 0;
+        
+        for (auto nodeElement : xml->getChildWithTagNameIterator("node"))
+        {
+            juce::ignoreUnused(nodeElement);
+            numNodes++;
+        }
+        
+        return numNodes;
+    }
+};
+
+static InstantiationBenchmark instantiationBenchmark;
@@ -0,0 +1,32 @@
+/*
+  ==============================================================================
+  
+    Main.cpp
+    Created: 20 Oct 2026 9:14:37am
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+// runs every test, or just those in the category given, e.g. FXGraphTests Stress
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; // makes this the message thread, as the editor's is in the plugin
+    
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    
+    if (argc > 1)
+        runner.runTestsInCategory(argv[1]);
+    else
+        runner.runAllTests();
+    
+    int numFailures = 0;
+    
+    for (int i = 0; i < runner.getNumResults(); i++)
+        numFailures += runner.getResult(i)->failures;
+    
+    return numFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,289 @@
+/*
+  ==============================================================================
+  
+    SwapStressTest.cpp
+    Created: 20 Oct 2026 9:21:05am
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/EditHistory.h"
+#include "Timings.h"
+
+/**
+ Edits a graph on the message thread as fast as it can, through the same commands as the editor, while one thread runs the processor block by block as a host would and another reads what the editor's timers and the host read off the message thread.
+ Meant to be run under the thread and address sanitisers, e.g. by turning them on in the Diagnostics tab of the scheme that runs FXGraphTests.
+ */
+class SwapStressTest : public juce::UnitTest
+{
+public:
+    SwapStressTest() : juce::UnitTest("Instance swap under concurrent editing", "Stress") {}
+    
+    static constexpr double sampleRate = 48000;
+    static constexpr int maxBlockSize = 512; // each block is anywhere up to this, as hosts do at loop points and around automation
+    static constexpr int numEdits = 5000;
+    static constexpr int maxNodes = 24;
+    
+    void runTest() override
+    {
+        beginTest("Edits, blocks and reads at once");
+        
+        FXGraphAudioProcessor processor;
+        processor.setRateAndBufferSizeDetails(sampleRate, maxBlockSize);
+        processor.prepareToPlay(sampleRate, maxBlockSize);
+        
+        auto dataManager = processor.getDataManager();
+        
+        dataManager->probe.start(0); // whichever stream has the id, as it's connected and disconnected
+        
+        juce::Random random;
+        logMessage("Seed: " + juce::String(random.getSeed()));
+        
+        AudioThread audioThread(processor, random.nextInt64());
+        ReaderThread readerThread(processor, random.nextInt64());
+        
+        audioThread.startThread();
+        readerThread.startThread();
+        
+        std::vector<double> editMs;
+        editMs.reserve(numEdits);
+        
+        for (int edit = 0; edit < numEdits; edit++)
+        {
+            const auto startTicks = juce::Time::getHighResolutionTicks();
+            
+            editRandomly(*dataManager, random);
+            
+            editMs.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000.0);
+            
+            readLikeTheEditor(processor, *dataManager);
+        }
+        
+        // what the last edit left, taken back from the queue if it's still there and queued again
+        dataManager->startEditing();
+        const auto expectedUids = getUids(dataManager->inactiveInstance);
+        dataManager->finishEditing();
+        
+        readerThread.stopThread(1000);
+        audioThread.stopThread(1000);
+        
+        expectGreaterThan(audioThread.numBlocks.load(), 0);
+        expectEquals(audioThread.numNonFiniteSamples.load(), 0, "the output went to NaN or infinity");
+        
+        expectGreaterThan(readerThread.numReads.load(), 0);
+        expectEquals(readerThread.numNonFiniteValues.load(), 0, "a value stream went to infinity");
+        
+        dataManager->realise(); // whatever the audio thread didn't get to before it stopped
+        
+        expect(getUids(dataManager->getActiveInstance()) == expectedUids, "an edit was lost, or swapped in twice");
+        
+        logMessage("Edits (start to finish): " + describeTimings(editMs));
+        logMessage("Blocks: " + describeTimings(audioThread.blockMs) + " over " + juce::String(audioThread.numBlocks.load()) + " blocks");
+        logMessage("Probed samples: " + juce::String(readerThread.numProbedSamples.load()));
+       
+       #if FXGRAPH_SWAP_LATENCY_STATS
+        logMessage(dataManager->getSwapLatency().getSummary());
+        
+        expectGreaterThan(dataManager->getSwapLatency().getNumSwaps(), 0);
+       #endif
+       
+        dataManager->probe.stop();
+    }
+
+private:
+    // the host's audio thread, calling processBlock() with a different number of samples each time
+    struct AudioThread : public juce::Thread
+    {
+        AudioThread(FXGraphAudioProcessor& p, juce::int64 seed) : juce::Thread("Stress audio"), processor(p), random(seed)
+        {
+            blockMs.reserve(maxRecordedBlocks);
+        }
+        
+        void run() override
+        {
+            juce::AudioBuffer<float> buffer(processor.getTotalNumInputChannels(), maxBlockSize);
+            juce::MidiBuffer midiMessages;
+            
+            while (!threadShouldExit())
+            {
+                const int numSamples = 1 + random.nextInt(maxBlockSize);
+                
+                juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples); // refers to buffer rather than allocating
+                
+                for (int channel = 0; channel < block.getNumChannels(); channel++)
+                    for (int i = 0; i < numSamples; i++)
+                        block.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+                
+                midiMessages.clear();
+                
+                const auto startTicks = juce::Time::getHighResolutionTicks();
+                
+                processor.processBlock(block, midiMessages);
+                
+                if (blockMs.size() < maxRecordedBlocks)
+                    blockMs.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000.0);
+                
+                for (int channel = 0; channel < block.getNumChannels(); channel++)
+                    for (int i = 0; i < numSamples; i++)
+                        if (!std::isfinite(block.getSample(channel, i))) numNonFiniteSamples++;
+                
+                numBlocks++;
+            }
+        }
+        
+        FXGraphAudioProcessor& processor;
+        juce::Random random;
+        
+        static constexpr size_t maxRecordedBlocks = 1 << 20;
+        std::vector<double> blockMs; // read once the thread has stopped
+        
+        std::atomic<int> numBlocks {0};
+        std::atomic<int> numNonFiniteSamples {0};
+    };
+    
+    // everything that's read off the message thread: the values the analysis graph plots, the probe the inspector drains,
+    // and the host automating the parameter inputs and reading the parameter outputs back
+    struct ReaderThread : public juce::Thread
+    {
+        ReaderThread(FXGraphAudioProcessor& p, juce::int64 seed) : juce::Thread("Stress reader"), processor(p), random(seed) {}
+        
+        void run() override
+        {
+            auto dataManager = processor.getDataManager();
+            float probed[1024];
+            
+            while (!threadShouldExit())
+            {
+                for (int streamId = 0; streamId < NUM_VALUE_STREAMS; streamId++)
+                {
+                    const float value = dataManager->getDisplayValue(streamId);
+                    
+                    if (!std::isnan(value) && !std::isfinite(value)) numNonFiniteValues++; // NAN is fine, for a stream that isn't set
+                }
+                
+                // the probe's only reader, which is all its FIFO needs
+                for (int numRead; (numRead = dataManager->probe.read(probed, juce::numElementsInArray(probed))) > 0;)
+                    numProbedSamples += numRead;
+                
+                for (auto parameter : processor.getParameters())
+                {
+                    auto withId = dynamic_cast<juce::AudioProcessorParameterWithID*>(parameter);
+                    
+                    if (withId != nullptr && withId->paramID.startsWith("input")) parameter->setValue(random.nextFloat());
+                    else juce::ignoreUnused(parameter->getValue());
+                }
+                
+                numReads++;
+                
+                juce::Thread::yield();
+            }
+        }
+        
+        FXGraphAudioProcessor& processor;
+        juce::Random random;
+        
+        std::atomic<int> numReads {0};
+        std::atomic<int> numNonFiniteValues {0};
+        std::atomic<int> numProbedSamples {0};
+    };
+    
+    // adds, removes or connects a node, or undoes or redoes, much as someone clicking around the editor would
+    void editRandomly(DataManager& dataManager, juce::Random& random)
+    {
+        const float choice = random.nextFloat();
+        
+        if (choice < 0.05f)
+        {
+            dataManager.undo();
+            return;
+        }
+        
+        if (choice < 0.08f)
+        {
+            dataManager.redo();
+            return;
+        }
+        
+        // the ids are picked from the instance the command will edit, which may still be queued, rather than the active one the
+        // editor draws. The audio thread swaps long before anyone can click again, but here the next edit comes straight after.
+        // perform()'s own startEditing() then finds the edit already started
+        dataManager.startEditing();
+        
+        auto instance = dataManager.inactiveInstance;
+        const int numNodes = getNumNodes(instance);
+        
+        if (numNodes == 2 || (choice < 0.35f && numNodes < maxNodes))
+        {
+            const auto type = NodeTypes[2 + random.nextInt(juce::numElementsInArray(NodeTypes) - 2)]; // any but the main input and output
+            
+            dataManager.perform(new Edit::AddNode(type, {random.nextFloat() * 1000.0f, random.nextFloat() * 1000.0f}));
+        }
+        else if (choice < 0.5f)
+        {
+            dataManager.perform(new Edit::RemoveNode(2 + random.nextInt(numNodes - 2))); // never the main input or output
+        }
+        else
+        {
+            Data::Endpoint producer {random.nextInt(numNodes), 0};
+            Data::Endpoint consumer {random.nextInt(numNodes), 0};
+            
+            producer.paramId = random.nextInt(juce::jmax(1, getNumActive(instance->nodes[producer.nodeId]->outputParams)));
+            consumer.paramId = random.nextInt(juce::jmax(1, getNumActive(instance->nodes[consumer.nodeId]->inputParams)));
+            
+            auto& output = instance->nodes[producer.nodeId]->outputParams[producer.paramId];
+            auto& input = instance->nodes[consumer.nodeId]->inputParams[consumer.paramId];
+            
+            // some tries don't fit, like drags that end on the wrong kind of parameter; compile() copes with any cycles the rest make
+            if (producer.nodeId != consumer.nodeId && output.isActive && input.isActive && output.type == input.type)
+                dataManager.perform(new Edit::Connect(output.type, producer, consumer));
+            else
+                dataManager.finishEditing(); // nothing changed, but it's swapped like any other edit
+        }
+    }
+    
+    // what the graph area and the inspector read on their timers, and the host saving the session, all on the message thread
+    void readLikeTheEditor(FXGraphAudioProcessor& processor, DataManager& dataManager)
+    {
+        auto instance = dataManager.getActiveInstance();
+        
+        for (int nodeId = 0; nodeId < getNumNodes(instance); nodeId++)
+            expect(dataManager.layout.getLabel(instance->nodes[nodeId]).isNotEmpty());
+        
+        juce::MemoryBlock state;
+        processor.getStateInformation(state);
+    }
+    
+    static int getNumNodes(Data::DataInstance* instance)
+    {
+        int numNodes = 0;
+        
+        while (numNodes < NUM_NODES && instance->nodes[numNodes] != nullptr) numNodes++;
+        
+        return numNodes;
+    }
+    
+    template <typename Param>
+    static int getNumActive(Param (&params)[NUM_PARAMS])
+    {
+        int numActive = 0;
+        
+        while (numActive < NUM_PARAMS && params[numActive].isActive) numActive++;
+        
+        return numActive;
+    }
+    
+    static juce::Array<int> getUids(Data::DataInstance* instance)
+    {
+        juce::Array<int> uids;
+        
+        for (int nodeId = 0; nodeId < getNumNodes(instance); nodeId++)
+            uids.add(instance->nodes[nodeId]->uid);
+        
+        return uids;
+    }
+};
+
+static SwapStressTest swapStressTest;
@@ -0,0 +1,25 @@
+/*
+  ==============================================================================
+  
+    Timings.h
+    Created: 20 Oct 2026 10:02:48am
+    Author:  School
+  
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// the spread of a set of timings in ms, for the tests to log
+inline juce::String describeTimings(std::vector<double> ms)
+{
+    if (ms.empty()) return "none";
+    
+    std::sort(ms.begin(), ms.end());
+    
+    auto percentile = [&ms] (double p) {return juce::String(ms[(size_t) (p / 100.0 * (double) (ms.size() - 1))], 3) + "ms";};
+    
+    return "p50 " + percentile(50) + ", p90 " + percentile(90) + ", p99 " + percentile(99) + ", p99.9 " + percentile(99.9) + ", max " + percentile(100);
+}